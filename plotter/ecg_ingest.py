@@ -0,0 +1,155 @@
+import argparse
+import sys
+import time
+import serial
+
+from ecg_plotter import FrameRing, SerialReader, RING_FRAMES, READ_TIMEOUT, STREAM_BEATS, STREAM_FILTERED, STREAM_HRV, STREAM_META, STREAM_STATS, config_command, decode_beats, decode_hrv, decode_meta
+from ecg_record import Recorder, device_path
+
+# Ingesta sin interfaz: lee el puerto con el mismo hilo y decodificador que el
+# plotter y mide el caudal. Con la placa simulada de la compilacion en PC:
+#
+#   ./build-host/ecg_pty -r 10          (imprime la pty, por ejemplo /dev/pts/3)
+#   python ecg_ingest.py /dev/pts/3 -t 30
+#
+# Con varios puertos cada uno tiene su hilo, su cola y sus contadores. Con
+# --config 4000:256 se le pide a cada placa otra fs y otro largo de ventana al
+# conectar.
+
+# Periodo en segundos con el que el consumidor vacia la cola (como el render)
+INGEST_PERIOD = 1 / 60
+
+
+class IngestStats():
+    """
+    Cuenta tramas, bytes y perdidas de lo que sale de la cola del render
+    """
+
+    def __init__(self):
+        self.frames = 0
+        # Tramas y bytes al empezar el ultimo reporte
+        self.last_frames = 0
+        self.last_bytes = 0
+        # Bloques filtrados que faltan segun la secuencia
+        self.lost_blocks = 0
+        # Bloques perdidos en la placa segun el ultimo STREAM_STATS
+        self.board_dropped = 0
+        # Latidos detectados y ultimo intervalo RR en muestras
+        self.beats = 0
+        self.last_rr = 0
+        # Ultimo resumen de variabilidad
+        self.hrv = None
+        # Configuracion segun la ultima STREAM_META (fs, fft_len)
+        self.config = None
+        self._next_seq = None
+
+    def add(self, frames):
+        self.frames += len(frames)
+        for stream, seq, payload in frames:
+            if stream == STREAM_FILTERED:
+                if self._next_seq is not None and seq > self._next_seq:
+                    self.lost_blocks += seq - self._next_seq
+                self._next_seq = seq + 1
+            elif stream == STREAM_BEATS:
+                for sample, amplitude, rr, offset in decode_beats(payload):
+                    self.beats += 1
+                    self.last_rr = rr
+            elif stream == STREAM_HRV:
+                self.hrv = decode_hrv(payload) or self.hrv
+            elif stream == STREAM_STATS and len(payload) > 1:
+                self.board_dropped = int(payload[1])
+            elif stream == STREAM_META and decode_meta(payload):
+                self.config = decode_meta(payload)[:2]
+                # Al reconfigurar la placa descarta los bloques en vuelo
+                self._next_seq = None
+
+
+class IngestDevice():
+    """
+    Puerto leido por su propio hilo, con su cola y sus contadores
+    """
+
+    def __init__(self, name, recorder=None):
+        self.name = name
+        self.port = serial.Serial(name, 115200, timeout=READ_TIMEOUT)
+        self.recorder = recorder
+        self.ring = FrameRing(RING_FRAMES)
+        self.reader = SerialReader(self.port, self.ring, recorder)
+        self.stats = IngestStats()
+
+    def close(self):
+        self.reader.stop()
+        self.stats.add(self.ring.drain())
+        self.port.close()
+        if self.recorder:
+            self.recorder.close()
+
+    @property
+    def lost(self):
+        return self.reader.errors or self.ring.dropped or self.stats.lost_blocks
+
+
+def report(device, elapsed, frames, nbytes, period):
+    stats = device.stats
+    config = f"  {stats.config[0]:g} Hz/{stats.config[1]}" if stats.config else ""
+    # Frecuencia cardiaca del ultimo intervalo RR
+    if stats.last_rr and stats.config:
+        config += f"  latidos {stats.beats} ({60 * stats.config[0] / stats.last_rr:.0f} lpm)"
+    if stats.hrv and stats.hrv["intervals"]:
+        config += f"  SDNN {stats.hrv['sdnn_ms']:.1f} ms  RMSSD {stats.hrv['rmssd_ms']:.1f} ms"
+    print(f"{device.name:<14}{elapsed:7.1f} s  {frames / period:8.0f} tramas/s  {nbytes / period / 1e6:6.3f} MB/s  "
+          f"crc {device.reader.errors}  cola {device.ring.dropped}  bloques perdidos {stats.lost_blocks}  "
+          f"placa {stats.board_dropped}{config}", flush=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Ingesta de tramas del ECG sin interfaz")
+    parser.add_argument("ports", nargs="+", help="puertos serie o ptys")
+    parser.add_argument("-t", "--seconds", type=float, default=0, help="duracion (0 hasta Ctrl+C)")
+    parser.add_argument("--record", metavar="ARCHIVO", help="graba lo que llega por cada puerto (ARCHIVO-puerto, ver ecg_record.py)")
+    parser.add_argument("--config", metavar="FS:MUESTRAS", help="frecuencia de muestreo y largo de ventana para cada placa")
+    args = parser.parse_args()
+
+    command = None
+    if args.config:
+        fs, fft_len = args.config.split(":")
+        command = config_command(float(fs), int(fft_len))
+
+    devices = [IngestDevice(name, Recorder(device_path(args.record, name)) if args.record else None) for name in args.ports]
+    for device in devices:
+        device.reader.start()
+        if command:
+            device.port.write(command)
+
+    start = last = time.monotonic()
+    try:
+        while not args.seconds or time.monotonic() - start < args.seconds:
+            if all(device.reader.error for device in devices):
+                break
+            for device in devices:
+                device.stats.add(device.ring.drain())
+            now = time.monotonic()
+            if now - last >= 1.0:
+                for device in devices:
+                    stats = device.stats
+                    report(device, now - start, stats.frames - stats.last_frames, device.reader.bytes - stats.last_bytes, now - last)
+                    stats.last_frames, stats.last_bytes = stats.frames, device.reader.bytes
+                last = now
+            time.sleep(INGEST_PERIOD)
+    except KeyboardInterrupt:
+        pass
+    for device in devices:
+        device.close()
+
+    elapsed = time.monotonic() - start
+    print("Total:")
+    for device in devices:
+        report(device, elapsed, device.stats.frames, device.reader.bytes, elapsed)
+        if device.reader.error:
+            print(f"{device.name:<14}{device.reader.error}")
+    # Falla si se perdio algo en el camino
+    return 1 if any(device.lost for device in devices) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,78 +1,923 @@
 import dearpygui.dearpygui as dpg
 import serial.tools.list_ports
 import serial
+import binascii
+import struct
+import threading
 import time
-import json
+import numpy as np
+from collections import deque
+
+# Trama binaria del firmware (ver rp2040_c/include/protocol.h)
+SYNC = b"\xA5\x5A"
+HEADER = struct.Struct("<2sBBIH")
+CRC_LEN = 2
+CRC_INIT = 0xFFFF
+
+# Identificadores de flujo
+STREAM_FREQS = 0
+STREAM_IFFT_REAL = 1
+STREAM_FFT_REAL = 2
+STREAM_TIME = 3
+STREAM_IFFT_FILTERED = 4
+STREAM_FFT_FILTERED = 5
+STREAM_STATS = 6
+STREAM_META = 7
+STREAM_FILTERED = 8
+STREAM_PROFILE = 9
+STREAM_PSD = 10
+STREAM_BEATS = 11
+STREAM_HRV = 12
+STREAM_LEADS = 13
+
+# Configuracion de la sesion (protocol_meta_t): fs, fft_len, volts por cuenta, notch, pasabanda, derivaciones
+META = struct.Struct("<fIffffI")
+# Las placas anteriores a las derivaciones mandan la configuracion sin el ultimo campo
+META_SINGLE_LEAD = struct.Struct("<fIffff")
+# Derivaciones que puede mandar el firmware (DSP_IIR_LEADS_MAX)
+LEADS_MAX = 4
+
+# Latido detectado (qrs_beat_t): muestra del pico, amplitud en volts, RR en muestras, fraccion de muestra
+BEAT = struct.Struct("<IfIf")
+# Intervalos RR promediados para la frecuencia cardiaca
+BEATS_AVERAGE = 8
+# Resumen de variabilidad (hrv_summary_t, float32), en el orden del firmware
+HRV_FIELDS = ["intervals", "span_s", "mean_rr_ms", "heart_rate_bpm", "sdnn_ms", "rmssd_ms", "pnn50", "lf_ms2", "hf_ms2", "lf_hf"]
+
+# Comandos al firmware (protocol_command_t), misma trama con payload en bytes
+COMMAND_CONFIG = 0x80
+# Configuracion pedida (protocol_config_t): fs, fft_len
+CONFIG = struct.Struct("<fI")
+# Rangos que acepta el firmware (FS_MIN, FS_MAX y potencias de 2 de FFT_LEN_MIN a FFT_LEN_MAX)
+FS_RANGE = (250.0, 10000.0)
+FFT_LENS = [64, 128, 256, 512, 1024, 2048, 4096]
+
+# Etapas medidas en el firmware (profile_stage_t), cada una manda
+# mediciones, minimo, media, maximo y tiempo disponible en us
+PROFILE_STAGES = [
+    "IRQ DMA",
+    "Filtro IIR",
+    "Espectro entrada",
+    "Espectro filtrado",
+    "Envio bloque",
+    "Envio ventana",
+    "PSD Welch",
+    "Detector QRS",
+    "HRV",
+    "Diezmado ADC",
+]
+PROFILE_FIELDS = 5
+
+# Configuracion hasta que llega la metadata de la sesion
+DEFAULT_FS = 1000.0
+DEFAULT_FFT_LEN = 1024
+
+# Series de DearPyGui y los arrays de PlotData que usan como ejes x e y
+SERIES = {
+    "fft_real": ("freqs", "fft_real"),
+    "fft_filtered": ("freqs", "fft_filtered"),
+    "ifft_real": ("time", "ifft_real"),
+    "ifft_filtered": ("time", "ifft_filtered"),
+    "psd": ("psd_freqs", "psd"),
+}
+# Derivaciones 2 en adelante, sobre el eje de tiempo de la ventana
+SERIES.update({f"lead{k}": ("time", f"lead{k}") for k in range(2, LEADS_MAX + 1)})
+
+# Flujos que reemplazan un array completo de PlotData
+STREAM_ARRAYS = {
+    STREAM_FREQS: "freqs",
+    STREAM_FFT_REAL: "fft_real",
+    STREAM_FFT_FILTERED: "fft_filtered",
+    STREAM_TIME: "time",
+    STREAM_IFFT_REAL: "ifft_real",
+    STREAM_IFFT_FILTERED: "ifft_filtered",
+}
+
+# Historia del registro continuo en segundos y ventana visible al arrancar
+STRIP_SECONDS = 600
+STRIP_SPAN = 10
+# Cada nivel de detalle junta LOD_FACTOR bloques del anterior, hasta que el
+# ultimo tenga a lo sumo LOD_TOP_POINTS bloques
+LOD_FACTOR = 4
+LOD_TOP_POINTS = 2048
+
+# Tramas que pueden esperar al render (si se llena se descartan las mas viejas)
+RING_FRAMES = 1024
+# Espera maxima de cada lectura del puerto en segundos (para poder frenar el hilo)
+READ_TIMEOUT = 0.1
+# Periodo en segundos con el que se buscan puertos nuevos
+PORT_POLL_PERIOD = 1.0
+# Texto del menu de puertos cuando no hay ninguno
+NO_PORTS = "No se encontraron puertos seriales."
+
+# Tipos de dato del payload
+DTYPES = {
+    0: np.dtype("<f4"),
+    1: np.dtype("<u4"),
+    2: np.dtype("<i2"),
+    3: np.dtype("<u2"),
+    4: np.dtype("u1"),
+}
+
+
+class FrameDecoder():
+    """
+    Arma tramas binarias a partir de los bytes que llegan por el puerto serie
+    """
+
+    def __init__(self):
+        # Bytes recibidos que todavia no forman una trama
+        self._buffer = bytearray()
+        # Tramas descartadas por CRC o encabezado invalido
+        self.errors = 0
+
+    def feed(self, data):
+        """
+        Agrega bytes recibidos y devuelve las tramas completas como (stream, seq, array)
+        """
+        buffer = self._buffer
+        buffer += data
+        frames = []
+        # Recorro con un indice y recorto el buffer una sola vez al final
+        pos = 0
+        while True:
+            # Busco el sincronismo
+            start = buffer.find(SYNC, pos)
+            if start < 0:
+                # Me quedo con el ultimo byte por si es la mitad del sincronismo
+                pos = max(pos, len(buffer) - 1)
+                break
+            pos = start
+            # Espero a tener el encabezado completo
+            if len(buffer) - pos < HEADER.size:
+                break
+            _, stream, dtype, seq, count = HEADER.unpack_from(buffer, pos)
+            if dtype not in DTYPES:
+                # Sincronismo falso, sigo buscando desde el proximo byte
+                self.errors += 1
+                pos += 1
+                continue
+            # Espero a tener el payload y el CRC
+            end = pos + HEADER.size + count * DTYPES[dtype].itemsize
+            if len(buffer) < end + CRC_LEN:
+                break
+            crc = int.from_bytes(buffer[end:end + CRC_LEN], "little")
+            with memoryview(buffer) as view:
+                valid = binascii.crc_hqx(view[pos + 2:end], CRC_INIT) == crc
+            if not valid:
+                self.errors += 1
+                pos += 1
+                continue
+            # Copio el payload directo del buffer antes de soltar los bytes
+            payload = np.frombuffer(buffer, dtype=DTYPES[dtype], count=count, offset=pos + HEADER.size).copy()
+            frames.append((stream, seq, payload))
+            pos = end + CRC_LEN
+        del buffer[:pos]
+        return frames
+
+
+def encode_frame(stream, payload, dtype=4, seq=0):
+    """
+    Arma una trama como las del firmware (por defecto con el payload en bytes)
+    """
+    payload = bytes(payload)
+    count = len(payload) // DTYPES[dtype].itemsize
+    frame = HEADER.pack(SYNC, stream, dtype, seq, count) + payload
+    return frame + binascii.crc_hqx(frame[2:], CRC_INIT).to_bytes(CRC_LEN, "little")
+
+
+def config_command(fs, fft_len):
+    """
+    Comando para cambiar la frecuencia de muestreo y el largo de ventana (la placa contesta con STREAM_META)
+    """
+    return encode_frame(COMMAND_CONFIG, CONFIG.pack(fs, fft_len))
+
+
+class PlotData():
+    """
+    Datos del plotter en arrays float32 preasignados, con registro de lo que cambio
+    """
+
+    def __init__(self, fs=DEFAULT_FS, fft_len=DEFAULT_FFT_LEN):
+        self.resize(fs, fft_len)
+
+    def resize(self, fs, fft_len):
+        """
+        Reasigna los arrays y arma los ejes para una configuracion nueva
+        """
+        self.fs = fs
+        self.fft_len = fft_len
+        self.freqs = np.arange(fft_len // 2, dtype=np.float32) * np.float32(fs / fft_len)
+        self.time = np.arange(fft_len, dtype=np.float32) / np.float32(fs)
+        self.fft_real = np.zeros(fft_len // 2, dtype=np.float32)
+        self.fft_filtered = np.zeros(fft_len // 2, dtype=np.float32)
+        self.ifft_real = np.zeros(fft_len, dtype=np.float32)
+        self.ifft_filtered = np.zeros(fft_len, dtype=np.float32)
+        for k in range(2, LEADS_MAX + 1):
+            setattr(self, f"lead{k}", np.zeros(fft_len, dtype=np.float32))
+        # La PSD tiene sus propios bins, se arman con la primera trama
+        self.psd_freqs = np.zeros(0, dtype=np.float32)
+        self.psd = np.zeros(0, dtype=np.float32)
+        # Arrays que cambiaron desde el ultimo render
+        self.dirty = {"freqs", "time"}
+
+    def store(self, name, payload):
+        """
+        Copia un array completo (si el largo no coincide se copia lo que entra)
+        """
+        dst = getattr(self, name)
+        n = min(len(dst), len(payload))
+        dst[:n] = payload[:n]
+        self.dirty.add(name)
+
+    def store_psd(self, payload):
+        """
+        Copia la PSD de Welch y rearma sus bins si cambio el largo del segmento
+        """
+        if len(payload) != len(self.psd):
+            self.psd_freqs = np.arange(len(payload), dtype=np.float32) * np.float32(self.fs / (2 * len(payload)))
+            self.psd = np.zeros(len(payload), dtype=np.float32)
+            self.dirty.add("psd_freqs")
+        self.store("psd", payload)
+
+    def append(self, name, payload):
+        """
+        Corre el array y agrega las muestras nuevas al final
+        """
+        dst = getattr(self, name)
+        n = len(payload)
+        if n >= len(dst):
+            dst[:] = payload[-len(dst):]
+        else:
+            dst[:-n] = dst[n:]
+            dst[-n:] = payload
+        self.dirty.add(name)
+
+    def take_dirty(self):
+        """
+        Devuelve los arrays que cambiaron y limpia el registro
+        """
+        dirty = self.dirty
+        self.dirty = set()
+        return dirty
+
+
+class StripChart():
+    """
+    Historia circular de la señal filtrada con una piramide de minimos y maximos
+    para dibujar cualquier tramo con unos dos puntos por pixel
+    """
+
+    def __init__(self, fs, seconds=STRIP_SECONDS):
+        self.fs = fs
+        capacity = int(seconds * fs)
+        levels = 0
+        while capacity // LOD_FACTOR ** levels > LOD_TOP_POINTS:
+            levels += 1
+        # La capacidad es multiplo del bloque mas grande para que los niveles den la vuelta juntos
+        block = LOD_FACTOR ** levels
+        self.capacity = -(-capacity // block) * block
+        # Muestras recibidas desde el arranque
+        self.total = 0
+        # Nivel 0: muestras crudas, nivel k: bloques de LOD_FACTOR**k muestras
+        raw = np.zeros(self.capacity, dtype=np.float32)
+        self._mins = [raw]
+        self._maxs = [raw]
+        for k in range(1, levels + 1):
+            self._mins.append(np.zeros(self.capacity // LOD_FACTOR ** k, dtype=np.float32))
+            self._maxs.append(np.zeros(self.capacity // LOD_FACTOR ** k, dtype=np.float32))
+        # Hay muestras nuevas desde el ultimo render
+        self.dirty = True
+
+    @property
+    def duration(self):
+        """
+        Tiempo en segundos de la ultima muestra
+        """
+        return self.total / self.fs
+
+    def append(self, samples):
+        """
+        Agrega muestras y recalcula solo los bloques que las contienen
+        """
+        if len(samples) > self.capacity:
+            self.total += len(samples) - self.capacity
+            samples = samples[-self.capacity:]
+        lo = self.total
+        self.total += len(samples)
+        hi = self.total
+        self._mins[0][np.arange(lo, hi) % self.capacity] = samples
+        for k in range(1, len(self._mins)):
+            lo //= LOD_FACTOR
+            hi = -(-hi // LOD_FACTOR)
+            self._reduce(k, lo, hi)
+        self.dirty = True
+
+    def _reduce(self, k, lo, hi):
+        """
+        Minimo y maximo de los bloques lo a hi del nivel k a partir del nivel k - 1
+        """
+        # El ultimo bloque puede estar incompleto, repito su ultimo hijo
+        available = -(-self.total // LOD_FACTOR ** (k - 1))
+        children = np.minimum(np.arange(lo * LOD_FACTOR, hi * LOD_FACTOR), available - 1) % len(self._mins[k - 1])
+        slots = np.arange(lo, hi) % len(self._mins[k])
+        self._mins[k][slots] = self._mins[k - 1][children].reshape(-1, LOD_FACTOR).min(axis=1)
+        self._maxs[k][slots] = self._maxs[k - 1][children].reshape(-1, LOD_FACTOR).max(axis=1)
+
+    def view(self, t0, t1, width):
+        """
+        Devuelve x e y para dibujar el tramo t0 a t1 en un grafico de width pixeles
+        """
+        oldest = max(0, self.total - self.capacity)
+        i0 = max(oldest, int(np.floor(t0 * self.fs)))
+        i1 = min(self.total, int(np.ceil(t1 * self.fs)) + 1)
+        if i1 <= i0:
+            return np.zeros(0), np.zeros(0, dtype=np.float32)
+        # Nivel mas fino que no pasa de dos puntos por pixel
+        k = 0
+        if i1 - i0 > 2 * width:
+            k = 1
+            while k + 1 < len(self._mins) and (i1 - i0) / LOD_FACTOR ** k > width:
+                k += 1
+        if k == 0:
+            index = np.arange(i0, i1)
+            return index / self.fs, self._mins[0][index % self.capacity]
+        # Cada bloque se dibuja como un segmento vertical de su minimo a su maximo
+        block = LOD_FACTOR ** k
+        blocks = np.arange(max(i0 // block, -(-oldest // block)), -(-i1 // block))
+        slots = blocks % len(self._mins[k])
+        y = np.empty(2 * len(blocks), dtype=np.float32)
+        y[0::2] = self._mins[k][slots]
+        y[1::2] = self._maxs[k][slots]
+        return np.repeat(blocks * block / self.fs, 2), y
+
+
+class FrameRing():
+    """
+    Cola acotada de tramas entre el hilo lector y el render
+    """
+
+    def __init__(self, capacity):
+        self._frames = deque(maxlen=capacity)
+        self._lock = threading.Lock()
+        # Tramas descartadas porque el render no las saco a tiempo
+        self.dropped = 0
+
+    def push(self, frames):
+        """
+        Agrega tramas decodificadas (desde el hilo lector)
+        """
+        with self._lock:
+            overflow = len(self._frames) + len(frames) - self._frames.maxlen
+            if overflow > 0:
+                self.dropped += overflow
+            self._frames.extend(frames)
+
+    def free(self):
+        """
+        Lugar que queda antes de descartar tramas
+        """
+        with self._lock:
+            return self._frames.maxlen - len(self._frames)
+
+    def drain(self):
+        """
+        Saca todas las tramas pendientes (desde el render)
+        """
+        with self._lock:
+            frames = list(self._frames)
+            self._frames.clear()
+        return frames
+
+
+class SerialReader():
+    """
+    Hilo que lee el puerto serie y decodifica tramas sin esperar al render
+    """
+
+    def __init__(self, port, ring, recorder=None):
+        self._port = port
+        self._ring = ring
+        # Grabacion opcional de todo lo que llega (ver ecg_record.py)
+        self._recorder = recorder
+        self._decoder = FrameDecoder()
+        self._stop = threading.Event()
+        self._thread = threading.Thread(target=self._run, daemon=True)
+        # Bytes leidos del puerto
+        self.bytes = 0
+        # Error del puerto que freno el hilo
+        self.error = None
+
+    @property
+    def errors(self):
+        """
+        Tramas descartadas por CRC o encabezado invalido
+        """
+        return self._decoder.errors
+
+    def start(self):
+        self._thread.start()
+
+    def stop(self):
+        self._stop.set()
+        self._thread.join()
+
+    def _run(self):
+        while not self._stop.is_set():
+            try:
+                # Bloquea hasta READ_TIMEOUT si no hay nada
+                data = self._port.read(max(1, self._port.in_waiting))
+            except (serial.SerialException, OSError) as e:
+                self.error = str(e)
+                break
+            if data:
+                self.bytes += len(data)
+                frames = self._decoder.feed(data)
+                if frames:
+                    # Se graba antes del render para no perder lo que este descarte
+                    if self._recorder:
+                        self._recorder.write(frames)
+                    self._ring.push(frames)
+
+
+class PortWatcher():
+    """
+    Hilo que lista los puertos serie de vez en cuando y avisa solo si cambiaron
+    """
+
+    def __init__(self, period=PORT_POLL_PERIOD):
+        self._period = period
+        self._ports = None
+        # Lista nueva que todavia no tomo el render
+        self._pending = None
+        self._lock = threading.Lock()
+        self._stop = threading.Event()
+        self._thread = threading.Thread(target=self._run, daemon=True)
+
+    def start(self):
+        self._thread.start()
+
+    def stop(self):
+        self._stop.set()
+        self._thread.join()
+
+    def take_changes(self):
+        """
+        Devuelve la lista de puertos si cambio desde la ultima llamada, o None
+        """
+        with self._lock:
+            ports = self._pending
+            self._pending = None
+        return ports
+
+    def _run(self):
+        while True:
+            ports = sorted(port.device for port in serial.tools.list_ports.comports())
+            if ports != self._ports:
+                self._ports = ports
+                with self._lock:
+                    self._pending = ports
+            if self._stop.wait(self._period):
+                break
+
+
+def decode_beats(payload):
+    """
+    Latidos de una trama STREAM_BEATS como (muestra, amplitud, RR, fraccion), ignorando un resto incompleto
+    """
+    data = payload.tobytes()
+    return BEAT.iter_unpack(data[:len(data) - len(data) % BEAT.size])
+
+
+def decode_meta(payload):
+    """
+    Configuracion de una trama STREAM_META como (fs, fft_len, volts por cuenta, notch, f1, f2, derivaciones), None si el largo no coincide
+    """
+    if payload.nbytes == META.size:
+        return META.unpack(payload.tobytes())
+    if payload.nbytes == META_SINGLE_LEAD.size:
+        return META_SINGLE_LEAD.unpack(payload.tobytes()) + (1,)
+    return None
+
+
+def decode_stats(payload):
+    """
+    Contadores de una trama STREAM_STATS como (muestras, bloques perdidos, bloques procesados), None si el largo no coincide
+    """
+    if len(payload) != 3:
+        return None
+    return tuple(int(x) for x in payload)
+
+
+def decode_hrv(payload):
+    """
+    Resumen de una trama STREAM_HRV como diccionario (None si el largo no coincide)
+    """
+    if len(payload) != len(HRV_FIELDS):
+        return None
+    return dict(zip(HRV_FIELDS, (float(x) for x in payload)))
+
+
+def profile_table(payload):
+    """
+    Arma la tabla de presupuesto de tiempos a partir de una trama STREAM_PROFILE
+    """
+    rows = payload.reshape(-1, PROFILE_FIELDS)
+    lines = [f"{'Etapa':<18}{'n':>6}{'min':>9}{'media':>9}{'max':>9}{'periodo':>10}{'max/periodo':>13}{'carga':>8}"]
+    for i, (count, min_us, mean_us, max_us, budget_us) in enumerate(rows):
+        name = PROFILE_STAGES[i] if i < len(PROFILE_STAGES) else f"Etapa {i}"
+        # Peor caso contra el periodo y fraccion media del tiempo ocupada
+        worst = 100.0 * max_us / budget_us if budget_us else 0.0
+        load = 100.0 * mean_us / budget_us if budget_us else 0.0
+        lines.append(f"{name:<18}{count:>6}{min_us:>9}{mean_us:>9}{max_us:>9}{budget_us:>10}{worst:>12.1f}%{load:>7.1f}%")
+    return "\n".join(lines)
+
+
+class DeviceView():
+    """
+    Dispositivo conectado: su hilo lector, su cola, sus datos y su columna de graficos
+    """
+
+    def __init__(self, name, parent, make_reader, port=None):
+        self.name = name
+        # Puerto serie si la fuente es una placa
+        self._port = port
+        # Cada dispositivo tiene su propia cola y su hilo que la llena
+        self._ring = FrameRing(RING_FRAMES)
+        self._reader = make_reader(self._ring)
+        # Configuracion de la sesion que manda el firmware
+        self._meta = None
+        # Latidos recibidos y ultimos intervalos RR en muestras
+        self._beat_count = 0
+        self._rr = deque(maxlen=BEATS_AVERAGE)
+        # Linea de estado: configuracion de la sesion y contadores de la adquisicion
+        self._config_status = ""
+        self._stats_status = ""
+
+        # Datos para mostrar
+        self._data = PlotData()
+        # Registro continuo de la señal filtrada y ultimo tramo dibujado (t0, t1, ancho)
+        self._strip = StripChart(DEFAULT_FS)
+        self._strip_view = None
+
+        # Caudal del ultimo segundo: instante, tramas y bytes al empezar
+        self._frames = 0
+        self._rate_start = (time.monotonic(), 0, 0)
+
+        self._build(parent)
+        self._reader.start()
+
+
+    def _build(self, parent):
+        """
+        Arma la columna de graficos del dispositivo
+        """
+        with dpg.child_window(parent=parent) as self.window:
+            dpg.add_text(self.name)
+            self._status = dpg.add_text("")
+            # Solo una placa acepta cambiar la adquisicion
+            if self._port:
+                with dpg.group(horizontal=True):
+                    self._config_fs = dpg.add_input_float(label="FS [Hz]", default_value=DEFAULT_FS, min_value=FS_RANGE[0],
+                                                          max_value=FS_RANGE[1], min_clamped=True, max_clamped=True, step=0, format="%.0f", width=100)
+                    self._config_len = dpg.add_combo([str(n) for n in FFT_LENS], label="Muestras", default_value=str(DEFAULT_FFT_LEN), width=80)
+                    dpg.add_button(label="Aplicar", callback=self._config_callback)
+            self._rate = dpg.add_text("")
+            self._beats = dpg.add_text("")
+            self._hrv = dpg.add_text("")
+            with dpg.collapsing_header(label="Tiempos por etapa"):
+                self._profile = dpg.add_text("")
+
+            # Espectro de la ventana
+            with dpg.plot(label="FFT Plot", height=-1, width=-1) as self._fft_plot:
+                self._freq_axis = dpg.add_plot_axis(dpg.mvXAxis, label="Frequency [Hz]")
+                y_axis = dpg.add_plot_axis(dpg.mvYAxis, label="Magnitude [V]")
+
+                self._series = {
+                    "fft_real": dpg.add_line_series([], [], label="FFT (real)", parent=y_axis),
+                    "fft_filtered": dpg.add_line_series([], [], label="FFT (filtrada)", parent=y_axis),
+                }
+
+                # Fijar los límites de los ejes
+                dpg.set_axis_limits(self._freq_axis, 0, 500)
+                dpg.set_axis_limits(y_axis, 0, 3.5)
+
+                # PSD de Welch en su propio eje logaritmico
+                psd_axis = dpg.add_plot_axis(dpg.mvYAxis, label="PSD [V²/Hz]", log_scale=True)
+                self._series["psd"] = dpg.add_line_series([], [], label="PSD Welch (filtrada)", parent=psd_axis)
+
+                # Muestro la etiqueta
+                dpg.add_plot_legend()
+
+            # Señal de la ventana
+            with dpg.plot(label="IFFT Plot", height=-1, width=-1) as self._ifft_plot:
+                dpg.add_plot_axis(dpg.mvXAxis, label="Time [s]")
+                y_axis = dpg.add_plot_axis(dpg.mvYAxis, label="Magnitude [V]")
+
+                self._series["ifft_real"] = dpg.add_line_series([], [], label="IFFT (real)", parent=y_axis)
+                self._series["ifft_filtered"] = dpg.add_line_series([], [], label="ECG (filtrada)", parent=y_axis)
+                # Las demas derivaciones aparecen cuando la configuracion dice que hay
+                for k in range(2, LEADS_MAX + 1):
+                    self._series[f"lead{k}"] = dpg.add_line_series([], [], label=f"Derivacion {k} (filtrada)", parent=y_axis, show=False)
+
+                # Fijar los límites de los ejes
+                dpg.set_axis_limits(y_axis, -3.5, 3.5)
+
+                # Muestro la etiqueta
+                dpg.add_plot_legend()
+
+            # Registro continuo de la señal filtrada
+            with dpg.group(horizontal=True):
+                self._strip_follow = dpg.add_checkbox(label="Seguir", default_value=True, callback=self._strip_follow_callback)
+                self._strip_span = dpg.add_slider_float(label="Ventana [s]", default_value=STRIP_SPAN, min_value=1, max_value=STRIP_SECONDS, format="%.0f", width=200)
+            with dpg.plot(label="ECG Strip", height=-1, width=-1) as self._strip_plot:
+                self._strip_time_axis = dpg.add_plot_axis(dpg.mvXAxis, label="Time [s]")
+                y_axis = dpg.add_plot_axis(dpg.mvYAxis, label="Magnitude [V]")
+
+                self._strip_series = dpg.add_line_series([], [], label="ECG (filtrada)", parent=y_axis)
+
+                # Fijar los límites de los ejes
+                dpg.set_axis_limits(y_axis, -3.5, 3.5)
+
+
+    def resize(self, width, height):
+        """
+        Reparte el alto entre los tres graficos
+        """
+        dpg.set_item_width(self.window, width)
+        dpg.set_item_height(self.window, height)
+        plot_height = max(50, (height - 130) // 3)
+        for plot in (self._fft_plot, self._ifft_plot, self._strip_plot):
+            dpg.set_item_height(plot, plot_height)
+
+
+    def update(self):
+        """
+        Saca lo que dejo el hilo lector y actualiza los graficos
+        """
+        frames = self._ring.drain()
+        self._frames += len(frames)
+        self._store_frames(frames)
+        self._update_plot()
+        self._update_rate()
+
+
+    def close(self):
+        """
+        Frena el hilo lector y cierra el puerto
+        """
+        self._reader.stop()
+        if self._port:
+            self._port.close()
+        dpg.delete_item(self.window)
+
+
+    def _update_rate(self):
+        """
+        Muestra el caudal y las perdidas del dispositivo una vez por segundo
+        """
+        now = time.monotonic()
+        start, frames, nbytes = self._rate_start
+        if now - start < 1.0:
+            return
+        elapsed = now - start
+        rate = f"{(self._frames - frames) / elapsed:.0f} tramas/s, {(self._reader.bytes - nbytes) / elapsed / 1e3:.1f} kB/s, " \
+            f"{self._reader.errors} con error, {self._ring.dropped} descartadas"
+        if self._reader.error:
+            rate += f" ({self._reader.error})"
+        dpg.set_value(self._rate, rate)
+        self._rate_start = (now, self._frames, self._reader.bytes)
+
+
+    def _store_frames(self, frames):
+        """
+        Guarda las tramas pendientes quedandose solo con la ultima de cada flujo
+        """
+        latest = {}
+        filtered = []
+        leads = []
+        beats = []
+        for stream, seq, payload in frames:
+            # Los bloques filtrados y los latidos se suman, el resto se reemplaza
+            if stream == STREAM_FILTERED:
+                filtered.append(payload)
+            elif stream == STREAM_LEADS:
+                leads.append(payload)
+            elif stream == STREAM_BEATS:
+                beats.append(payload)
+            else:
+                latest[stream] = payload
+        # La configuracion va primero porque define los ejes
+        if STREAM_META in latest:
+            self._store_frame(STREAM_META, latest.pop(STREAM_META))
+        for stream, payload in latest.items():
+            self._store_frame(stream, payload)
+        if filtered:
+            self._store_frame(STREAM_FILTERED, np.concatenate(filtered))
+        for payload in leads:
+            self._store_frame(STREAM_LEADS, payload)
+        if beats:
+            self._store_frame(STREAM_BEATS, np.concatenate(beats))
+
+
+    def _store_frame(self, stream, payload):
+        """
+        Guarda el payload de una trama segun su flujo
+        """
+        if stream == STREAM_META:
+            self._store_meta(payload)
+        elif stream in STREAM_ARRAYS:
+            self._data.store(STREAM_ARRAYS[stream], payload)
+        elif stream == STREAM_PROFILE:
+            dpg.set_value(self._profile, profile_table(payload))
+        elif stream == STREAM_PSD:
+            self._data.store_psd(payload)
+        elif stream == STREAM_BEATS:
+            self._store_beats(payload)
+        elif stream == STREAM_HRV:
+            self._store_hrv(payload)
+        elif stream == STREAM_STATS:
+            self._store_stats(payload)
+        elif stream == STREAM_FILTERED:
+            # Bloques chicos de la cadena IIR, me quedo con la ultima ventana y los sumo al registro
+            self._data.append("ifft_filtered", payload)
+            self._strip.append(payload)
+        elif stream == STREAM_LEADS and self._meta and self._meta["leads"] > 1 and len(payload) % (self._meta["leads"] - 1) == 0:
+            # Un bloque por derivacion, una detras de otra
+            for k, block in enumerate(np.split(payload, self._meta["leads"] - 1), start=2):
+                self._data.append(f"lead{k}", block)
+
+
+    def _store_meta(self, payload):
+        """
+        Guarda la configuracion de la sesion y arma los ejes localmente
+        """
+        meta = decode_meta(payload)
+        if not meta:
+            return
+        fs, fft_len, volts_per_count, notch_f0, bp_f1, bp_f2, leads = meta
+        self._meta = {
+            "fs": fs,
+            "fft_len": fft_len,
+            "volts_per_count": volts_per_count,
+            "notch_f0": notch_f0,
+            "bp_f1": bp_f1,
+            "bp_f2": bp_f2,
+            "leads": min(leads, LEADS_MAX),
+        }
+        for k in range(2, LEADS_MAX + 1):
+            dpg.configure_item(self._series[f"lead{k}"], show=k <= leads)
+        # Los ejes solo dependen de fs y fft_len
+        if (fs, fft_len) != (self._data.fs, self._data.fft_len):
+            self._data.resize(fs, fft_len)
+        # El detector vuelve a aprender con cada configuracion, los RR anteriores no sirven
+        self._rr.clear()
+        # Con otra frecuencia de muestreo el registro anterior no sirve
+        if fs != self._strip.fs:
+            self._strip = StripChart(fs)
+            self._strip_view = None
+        dpg.set_axis_limits(self._freq_axis, 0, fs / 2)
+        if self._port:
+            dpg.set_value(self._config_fs, fs)
+            dpg.set_value(self._config_len, str(fft_len))
+        self._config_status = f"FS = {fs:g} Hz, {fft_len} muestras, notch {notch_f0:g} Hz, pasabanda {bp_f1:g}-{bp_f2:g} Hz" \
+            + (f", {leads} derivaciones" if leads > 1 else "")
+        self._show_status()
+
+
+    def _store_stats(self, payload):
+        """
+        Muestra los bloques que proceso y los que perdio la placa desde que arranco
+        """
+        stats = decode_stats(payload)
+        if not stats:
+            return
+        samples, dropped, processed = stats
+        self._stats_status = f"{processed} bloques procesados, {dropped} perdidos"
+        self._show_status()
+
+
+    def _show_status(self):
+        """
+        Arma la linea de estado con la configuracion y los contadores
+        """
+        dpg.set_value(self._status, " | ".join(text for text in (self._config_status, self._stats_status) if text))
+
+
+    def _store_beats(self, payload):
+        """
+        Cuenta los latidos y muestra la frecuencia cardiaca con los ultimos intervalos RR
+        """
+        # Un payload sin latidos completos no cambia nada (y no deja amplitud para mostrar)
+        beats = list(decode_beats(payload))
+        if not beats:
+            return
+        for sample, amplitude, rr, offset in beats:
+            self._beat_count += 1
+            # El primer latido despues de configurar no tiene RR
+            if rr:
+                self._rr.append(rr)
+        if self._rr:
+            rr = np.mean(self._rr) / self._data.fs
+            dpg.set_value(self._beats, f"{self._beat_count} latidos, FC {60 / rr:.0f} lpm, RR {1e3 * rr:.0f} ms, R {amplitude:.2f} V")
+
+
+    def _store_hrv(self, payload):
+        """
+        Muestra el resumen de variabilidad de la ventana de la placa
+        """
+        hrv = decode_hrv(payload)
+        if not hrv or not hrv["intervals"]:
+            return
+        dpg.set_value(self._hrv, f"HRV {hrv['span_s']:.0f} s: SDNN {hrv['sdnn_ms']:.1f} ms, RMSSD {hrv['rmssd_ms']:.1f} ms, "
+                      f"pNN50 {hrv['pnn50']:.1f} %, LF {hrv['lf_ms2']:.0f} ms², HF {hrv['hf_ms2']:.0f} ms², LF/HF {hrv['lf_hf']:.2f}")
+
+
+    def _update_plot(self):
+        """
+        Actualiza la informacion del ploteo
+        """
+        # Solo mando a DearPyGui las series que cambiaron (acepta los arrays sin pasarlos a listas)
+        dirty = self._data.take_dirty()
+        for tag, (x, y) in SERIES.items():
+            if x in dirty or y in dirty:
+                dpg.set_value(self._series[tag], [getattr(self._data, x), getattr(self._data, y)])
+        self._update_strip()
+
+
+    def _update_strip(self):
+        """
+        Dibuja el tramo visible del registro continuo con el nivel de detalle que entra en el ancho
+        """
+        if dpg.get_value(self._strip_follow):
+            # Sigo la ultima muestra con la ventana elegida
+            t1 = self._strip.duration
+            t0 = t1 - dpg.get_value(self._strip_span)
+            dpg.set_axis_limits(self._strip_time_axis, t0, t1)
+        else:
+            # Tramo que dejo el usuario con zoom y desplazamiento
+            t0, t1 = dpg.get_axis_limits(self._strip_time_axis)
+        width = max(1, dpg.get_item_rect_size(self._strip_plot)[0])
+        view = (t0, t1, width)
+        if not self._strip.dirty and view == self._strip_view:
+            return
+        self._strip.dirty = False
+        self._strip_view = view
+        dpg.set_value(self._strip_series, list(self._strip.view(t0, t1, width)))
+
+
+    def _config_callback(self, sender, app_data):
+        """
+        Pide a la placa otra frecuencia de muestreo y largo de ventana, los ejes cambian con la STREAM_META que contesta
+        """
+        command = config_command(dpg.get_value(self._config_fs), int(dpg.get_value(self._config_len)))
+        try:
+            self._port.write(command)
+        except (serial.SerialException, OSError) as e:
+            self._config_status = f"No se pudo configurar: {e}"
+            self._show_status()
+
+
+    def _strip_follow_callback(self, sender, app_data):
+        """
+        Libera el eje de tiempo para hacer zoom cuando se deja de seguir la señal
+        """
+        if not app_data:
+            dpg.set_axis_limits_auto(self._strip_time_axis)
+
 
 class ECGPlotter():
 
-    def __init__(self, width, height):
+    def __init__(self, width, height, recorder_factory=None):
 
         self._width = width
         self._heigth = height
 
         # Configurar DearPyGui
         dpg.create_context()
-        dpg.create_viewport(title='ECG Plotter', width=width, height=height)
+        dpg.create_viewport(title='ECG Plotter', width=width, height=height, vsync=True)
 
-        # Puerto serial seleccionado
-        self._port = None
-
-        # Datos para mostrar
-        self._freqs = [0.0]
-        self._fft_real= [0.0]
-        self._fft_filtered = [0.0]
-        self._time = [0.0]
-        self._ifft_real = [0.0]
-        self._ifft_filtered = [0.0]
+        # Dispositivos conectados por nombre (puerto o grabacion)
+        self._devices = {}
+        # Arma el Recorder de cada puerto (ver ecg_record.py) y los que ya estan abiertos
+        self._recorder_factory = recorder_factory
+        self._recorders = {}
+        # Hilo que busca puertos sin frenar el render
+        self._port_watcher = PortWatcher()
 
         # Crear la ventana de selección de puerto serial
         with dpg.window(label="App", tag="app_window"):
 
             with dpg.child_window(tag="serial_window"):
-                dpg.add_text("Seleccione un puerto serial:")
+                dpg.add_text("Seleccione un puerto serial (seleccionarlo de nuevo lo desconecta):")
                 
-                # Listar los puertos seriales disponibles y crear el combo box
-                ports = [port.device for port in serial.tools.list_ports.comports()]
-
-                if ports:
-                    dpg.add_combo(ports, label="Puertos", callback=self._port_selected_callback, tag="serial_combo")
-                else:
-                    dpg.add_text("No se encontraron puertos seriales.")
+                # El combo box se llena cuando el hilo de puertos termina de listarlos
+                dpg.add_combo([NO_PORTS], label="Puertos", callback=self._port_selected_callback, tag="serial_combo")
 
                 dpg.add_text("", tag="serial_status")
 
-            # Configuro una ventana para el ploteo de la FFT
-            with dpg.child_window(tag="fft_window"):
-                with dpg.plot(label="FFT Plot", height=-1, width=-1, tag="fft_plot"):
-                    x_axis = dpg.add_plot_axis(dpg.mvXAxis, label="Frequency [Hz]", tag="freq_axis")
-                    y_axis = dpg.add_plot_axis(dpg.mvYAxis, label="Magnitude [V]", tag="fft_axis")
-                    
-                    dpg.add_line_series([], [], label="FFT (real)", parent=y_axis, tag="fft_real")
-                    dpg.add_line_series([], [], label="FFT (filtrada)", parent=y_axis, tag="fft_filtered")
-
-                    # Fijar los límites de los ejes
-                    dpg.set_axis_limits("freq_axis", 0, 500)
-                    dpg.set_axis_limits("fft_axis", 0, 3.5)
-
-                    # Muestro la etiqueta
-                    dpg.add_plot_legend(parent="fft_plot")
-            
-
-            # Configuro una ventana para el ploteo de la FFT
-            with dpg.child_window(tag="ifft_window"):
-                with dpg.plot(label="IFFT Plot", height=-1, width=-1, tag="ifft_plot"):
-                    x_axis = dpg.add_plot_axis(dpg.mvXAxis, label="Time [s]", tag="time_axis")
-                    y_axis = dpg.add_plot_axis(dpg.mvYAxis, label="Magnitude [V]", tag="ifft_axis")
-                    
-                    dpg.add_line_series([], [], label="IFFT (real)", parent=y_axis, tag="ifft_real")
-                    dpg.add_line_series([], [], label="IFFT (filtrada)", parent=y_axis, tag="ifft_filtered")
-
-                    # Fijar los límites de los ejes
-                    dpg.set_axis_limits("ifft_axis", -3.5, 3.5)
-
-                    # Muestro la etiqueta
-                    dpg.add_plot_legend(parent="ifft_plot")
+            # Una columna por dispositivo
+            dpg.add_group(horizontal=True, tag="device_tiles")
 
         # Conectar el callback de redimensionamiento
         dpg.set_viewport_resize_callback(self._resize_window_callback)
@@ -85,39 +930,38 @@ class ECGPlotter():
 
 
     def run(self):
-        # Actualizar el gráfico cada 100 ms
+        self._port_watcher.start()
+        # El ritmo lo marca el vsync de render_dearpygui_frame
         while dpg.is_dearpygui_running():
-            if self._port:
-                if self._port.in_waiting > 0:
-                    # Leo y decodifico el JSON
-                    data = self._port.readline().decode().strip()
-                    data = json.loads(data)
-                    # Veo si hay datos
-                    self._freqs = data.get("freqs", self._freqs)
-                    self._fft_real = data.get("fft_real", self._fft_real)
-                    self._fft_filtered = data.get("fft_filtered", self._fft_filtered)
-                    self._time = data.get("time", self._time)
-                    self._ifft_real = data.get("ifft_real", self._ifft_real)
-                    self._ifft_filtered = data.get("ifft_filtered", self._ifft_filtered)
-
-            self._update_plot()
+            # Los hilos lectores ya decodificaron todo lo que llego
+            for device in self._devices.values():
+                device.update()
+
             self._refresh_ports()
             dpg.render_dearpygui_frame()
 
-            time.sleep(0.1)
-
+        self._port_watcher.stop()
+        for device in self._devices.values():
+            device.close()
+        for recorder in self._recorders.values():
+            recorder.close()
         dpg.cleanup_dearpygui()
 
 
-    def _update_plot(self):
+    def add_source(self, name, make_reader, port=None):
         """
-        Actualiza la informacion del ploteo
+        Agrega un dispositivo cuyo hilo lector arma make_reader(ring) (por ejemplo una grabacion)
+        """
+        self._devices[name] = DeviceView(name, "device_tiles", make_reader, port)
+        self._resize_window_callback(None, None)
+
+
+    def _remove_device(self, name):
         """
-        # Actualizar los valores del gráfico
-        dpg.set_value("fft_real", [self._freqs, self._fft_real])
-        dpg.set_value("fft_filtered", [self._freqs, self._fft_filtered])
-        dpg.set_value("ifft_real", [self._time, self._ifft_real])
-        dpg.set_value("ifft_filtered", [self._time, self._ifft_filtered])
+        Desconecta un dispositivo y saca su columna
+        """
+        self._devices.pop(name).close()
+        self._resize_window_callback(None, None)
 
     
     def _resize_window_callback(self, sender, app_data):
@@ -128,31 +972,37 @@ class ECGPlotter():
         width, height = dpg.get_viewport_client_width() - 22.5, dpg.get_viewport_client_height() - 50
         dpg.set_item_width("serial_window", width)
         dpg.set_item_height("serial_window", height // 7)
-        dpg.set_item_width("fft_window", width)
-        dpg.set_item_height("fft_window", 3 * height // 7)
-        dpg.set_item_width("ifft_window", width)
-        dpg.set_item_height("ifft_window", 3 * height // 7)
+        # Reparto el ancho entre los dispositivos
+        if self._devices:
+            tile_width = width // len(self._devices) - 8
+            for device in self._devices.values():
+                device.resize(tile_width, 6 * height // 7)
 
     
     def _refresh_ports(self):
-        # Listar los puertos seriales disponibles y crear el combo box
-        ports = [port.device for port in serial.tools.list_ports.comports()]
-        if ports:
-            dpg.configure_item("serial_combo", items=ports)
-        else:
-            dpg.configure_item("serial_combo", items=["No se encontraron puertos seriales."])
+        # Actualizo el combo box solo si el hilo de puertos encontro cambios
+        ports = self._port_watcher.take_changes()
+        if ports is None:
+            return
+        dpg.configure_item("serial_combo", items=ports if ports else [NO_PORTS])
 
     
     def _port_selected_callback(self, sender, app_data):
         """
-        Obtiene el valor seleccionado del menu desplegable
+        Conecta el puerto seleccionado, o lo desconecta si ya estaba conectado
         """
-        if self._port:
-            self._port.close()
-            self._port = None
-        else:
+        if app_data in self._devices:
+            self._remove_device(app_data)
+            dpg.set_value(item="serial_status", value=f"Puerto {app_data} desconectado")
+        elif app_data != NO_PORTS:
             try:
-                self._port = serial.Serial(app_data, 115200)
-                dpg.set_value(item="serial_status", value=f"Puerto {app_data} conectado con exito!")
+                port = serial.Serial(app_data, 115200, timeout=READ_TIMEOUT)
             except:
                 dpg.set_value(item="serial_status", value="Error conectando al puerto!")
+                return
+            # La grabacion de cada puerto sigue abierta si se reconecta
+            if self._recorder_factory and app_data not in self._recorders:
+                self._recorders[app_data] = self._recorder_factory(app_data)
+            recorder = self._recorders.get(app_data)
+            self.add_source(app_data, lambda ring: SerialReader(port, ring, recorder), port)
+            dpg.set_value(item="serial_status", value=f"Puerto {app_data} conectado con exito!")
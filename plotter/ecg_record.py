@@ -0,0 +1,328 @@
+import argparse
+import os
+import struct
+import sys
+import threading
+import time
+import numpy as np
+
+from ecg_plotter import DTYPES, DEFAULT_FS, STREAM_FILTERED, STREAM_META, FrameDecoder, decode_meta
+
+# Grabacion de las tramas en disco. Despues de un encabezado fijo van bloques
+# de filas de un mismo flujo, con cada columna contigua para poder abrirla con
+# numpy.memmap sin leer el archivo:
+#
+#   encabezado  magic "ECGREC", version u16, arranque f8 (segundos epoch)
+#   bloque      magic "CHNK", stream u8, dtype u8, reservado u16, ancho u32, filas u32
+#               t f8[filas] (segundos desde el arranque) | seq u32[filas] | valores u32[filas] |
+#               datos dtype[filas, ancho]
+#
+# Los flujos de largo variable (STREAM_BEATS manda los latidos de cada bloque)
+# guardan cada fila con el ancho de la mas larga del bloque, rellena con
+# ceros, y la columna de valores dice cuantos son de la trama. Cada bloque se
+# rellena hasta un multiplo de 8 bytes para que las columnas queden
+# alineadas. Las grabaciones de la version 1 no tienen la columna de valores
+# (todas las filas de un bloque miden el ancho) y se siguen leyendo.
+#
+#   python ecg_record.py info sesion.rec
+#   python ecg_record.py import ecg.bin sesion.rec
+
+FILE_MAGIC = b"ECGREC"
+FILE_VERSION = 2
+FILE_VERSIONS = (1, 2)
+FILE_HEADER = struct.Struct("<6sHd")
+CHUNK_MAGIC = b"CHNK"
+CHUNK_HEADER = struct.Struct("<4sBBHII")
+CHUNK_ALIGN = 8
+
+# Filas que se juntan en memoria antes de escribir un bloque
+CHUNK_ROWS = 256
+
+# Codigo de cada tipo de dato del payload
+DTYPE_CODES = {dtype: code for code, dtype in DTYPES.items()}
+
+# Velocidades de reproduccion (0 es lo mas rapido que consuma el render)
+REPLAY_SPEEDS = [1.0, 10.0, 0.0]
+# Tramas por envio al reproducir sin esperar
+REPLAY_BATCH = 64
+
+
+def _padding(size):
+    return -size % CHUNK_ALIGN
+
+
+class Recorder():
+    """
+    Escribe tramas decodificadas en una grabacion, agrupadas por flujo
+    """
+
+    def __init__(self, path, rows=CHUNK_ROWS):
+        self._file = open(path, "wb")
+        self._rows = rows
+        self._start = time.monotonic()
+        self._file.write(FILE_HEADER.pack(FILE_MAGIC, FILE_VERSION, time.time()))
+        # Filas pendientes por flujo: (dtype, tiempos, secuencias, datos)
+        self._pending = {}
+        # El hilo lector escribe y el render cierra
+        self._lock = threading.Lock()
+
+    def write(self, frames, t=None):
+        """
+        Agrega tramas (stream, seq, array) recibidas en t segundos desde el arranque
+        """
+        if t is None:
+            t = time.monotonic() - self._start
+        with self._lock:
+            for stream, seq, payload in frames:
+                pending = self._pending.get(stream)
+                # Un cambio de tipo empieza un bloque nuevo (el largo puede cambiar dentro del bloque)
+                if pending and pending[0] != payload.dtype:
+                    self._write_chunk(stream)
+                    pending = None
+                if pending is None:
+                    pending = self._pending[stream] = (payload.dtype, [], [], [])
+                pending[1].append(t)
+                pending[2].append(seq)
+                pending[3].append(payload)
+                if len(pending[1]) >= self._rows:
+                    self._write_chunk(stream)
+
+    def close(self):
+        """
+        Escribe lo pendiente y cierra el archivo
+        """
+        with self._lock:
+            for stream in list(self._pending):
+                self._write_chunk(stream)
+            self._file.close()
+
+    def _write_chunk(self, stream):
+        dtype, times, seqs, payloads = self._pending.pop(stream)
+        counts = np.array([len(payload) for payload in payloads], dtype="<u4")
+        width = int(counts.max())
+        # Filas del ancho de la mas larga, rellenas con ceros
+        data = np.zeros((len(payloads), width), dtype=dtype.newbyteorder("<"))
+        for row, payload in zip(data, payloads):
+            row[:len(payload)] = payload
+        data = data.tobytes()
+        self._file.write(CHUNK_HEADER.pack(CHUNK_MAGIC, stream, DTYPE_CODES[dtype], 0, width, len(times)))
+        self._file.write(np.asarray(times, dtype="<f8").tobytes())
+        self._file.write(np.asarray(seqs, dtype="<u4").tobytes())
+        self._file.write(counts.tobytes())
+        self._file.write(data)
+        size = 16 * len(times) + len(data)
+        self._file.write(bytes(_padding(size)))
+
+
+class Recording():
+    """
+    Grabacion abierta con numpy.memmap, cada columna es una vista sobre el archivo
+    """
+
+    def __init__(self, path):
+        self._map = np.memmap(path, dtype=np.uint8, mode="r")
+        magic, version, self.started = FILE_HEADER.unpack_from(self._map, 0)
+        if magic != FILE_MAGIC or version not in FILE_VERSIONS:
+            raise ValueError(f"{path} no es una grabacion ECG")
+        # Bytes por fila de las columnas fijas (la version 1 no tiene la de valores)
+        fixed = 12 if version == 1 else 16
+        # Bloques del archivo: (stream, t, seq, datos, valores)
+        self._chunks = []
+        offset = FILE_HEADER.size
+        while offset + CHUNK_HEADER.size <= len(self._map):
+            magic, stream, dtype, _, width, rows = CHUNK_HEADER.unpack_from(self._map, offset)
+            dtype = DTYPES.get(dtype)
+            size = (fixed + width * dtype.itemsize) * rows if dtype else 0
+            # Un bloque cortado (grabacion interrumpida) termina la lectura
+            if magic != CHUNK_MAGIC or dtype is None or offset + CHUNK_HEADER.size + size > len(self._map):
+                break
+            offset += CHUNK_HEADER.size
+            t = self._column(offset, "<f8", rows)
+            seq = self._column(offset + 8 * rows, "<u4", rows)
+            if version == 1:
+                counts = np.full(rows, width, dtype=np.uint32)
+            else:
+                counts = self._column(offset + 12 * rows, "<u4", rows)
+            data = self._column(offset + fixed * rows, dtype, rows * width).reshape(rows, width)
+            self._chunks.append((stream, t, seq, data, counts))
+            offset += size + _padding(size)
+
+    def _column(self, offset, dtype, count):
+        return np.ndarray(count, dtype=dtype, buffer=self._map, offset=offset)
+
+    @property
+    def streams(self):
+        """
+        Flujos presentes en la grabacion
+        """
+        return sorted({chunk[0] for chunk in self._chunks})
+
+    @property
+    def duration(self):
+        """
+        Segundos entre la primera y la ultima trama
+        """
+        times = [chunk[1] for chunk in self._chunks if len(chunk[1])]
+        if not times:
+            return 0.0
+        return max(t[-1] for t in times) - min(t[0] for t in times)
+
+    def chunks(self, stream):
+        """
+        Devuelve los bloques de un flujo como (t, seq, datos, valores) sin copiar
+        """
+        return [chunk[1:] for chunk in self._chunks if chunk[0] == stream]
+
+    def read(self, stream):
+        """
+        Devuelve t, seq, datos (filas x ancho de la trama mas larga, rellenos con
+        ceros) y valores de cada trama de un flujo completo
+        """
+        chunks = self.chunks(stream)
+        if not chunks:
+            return np.zeros(0), np.zeros(0, dtype=np.uint32), np.zeros((0, 0), dtype=np.float32), np.zeros(0, dtype=np.uint32)
+        if len(chunks) == 1:
+            return chunks[0]
+        # Los bloques de distinto ancho se rellenan hasta el mas ancho
+        width = max(chunk[2].shape[1] for chunk in chunks)
+        data = [np.pad(chunk[2], ((0, 0), (0, width - chunk[2].shape[1]))) for chunk in chunks]
+        t, seq, _, counts = (np.concatenate(column) for column in zip(*chunks))
+        return t, seq, np.concatenate(data), counts
+
+    def samples(self, stream=STREAM_FILTERED):
+        """
+        Devuelve las muestras de un flujo de señal una detras de otra
+        """
+        _, _, data, counts = self.read(stream)
+        if np.all(counts == data.shape[1]):
+            return data.reshape(-1)
+        return np.concatenate([row[:count] for row, count in zip(data, counts)])
+
+    def frames(self):
+        """
+        Recorre todas las tramas en el orden en que llegaron como (t, stream, seq, array)
+        """
+        if not self._chunks:
+            return
+        times = np.concatenate([chunk[1] for chunk in self._chunks])
+        which = np.concatenate([np.full(len(chunk[1]), i) for i, chunk in enumerate(self._chunks)])
+        rows = np.concatenate([np.arange(len(chunk[1])) for chunk in self._chunks])
+        # Orden estable para que las tramas del mismo instante salgan como se grabaron
+        for i in np.argsort(times, kind="stable"):
+            stream, t, seq, data, counts = self._chunks[which[i]]
+            row = rows[i]
+            yield t[row], stream, int(seq[row]), data[row, :counts[row]]
+
+
+class Replayer():
+    """
+    Hilo que pasa una grabacion por el FrameRing del plotter como si llegara del puerto
+    """
+
+    def __init__(self, recording, ring, speed=1.0):
+        self._recording = recording
+        self._ring = ring
+        self._speed = speed
+        self._stop = threading.Event()
+        self._thread = threading.Thread(target=self._run, daemon=True)
+        # Mismos contadores que SerialReader (los bytes son de payload)
+        self.errors = 0
+        self.bytes = 0
+        self.error = None
+
+    def start(self):
+        self._thread.start()
+
+    def stop(self):
+        self._stop.set()
+        self._thread.join()
+
+    def _run(self):
+        start = time.monotonic()
+        first = None
+        batch = []
+        for t, stream, seq, payload in self._recording.frames():
+            if self._stop.is_set():
+                return
+            if first is None:
+                first = t
+            if self._speed:
+                # Espero a que corresponda la trama segun la velocidad
+                delay = start + (t - first) / self._speed - time.monotonic()
+                if delay > 0 and self._stop.wait(delay):
+                    return
+                self._ring.push([(stream, seq, payload.copy())])
+                self.bytes += payload.nbytes
+                continue
+            batch.append((stream, seq, payload.copy()))
+            self.bytes += payload.nbytes
+            if len(batch) >= REPLAY_BATCH:
+                self._push_when_free(batch)
+                batch = []
+        if batch:
+            self._push_when_free(batch)
+
+    def _push_when_free(self, frames):
+        # Sin esperas el limite es el render, no descarto tramas
+        while self._ring.free() < len(frames):
+            if self._stop.wait(0.001):
+                return
+        self._ring.push(frames)
+
+
+def device_path(path, name):
+    """
+    Ruta de la grabacion de un dispositivo (sesion.rec y /dev/ttyACM0 dan sesion-ttyACM0.rec)
+    """
+    stem, ext = os.path.splitext(path)
+    return f"{stem}-{os.path.basename(name)}{ext}"
+
+
+def import_capture(source, path):
+    """
+    Pasa una captura binaria (por ejemplo la salida de ecg_replay) a una grabacion,
+    con el tiempo contado por las muestras filtradas
+    """
+    recorder = Recorder(path)
+    decoder = FrameDecoder()
+    fs = DEFAULT_FS
+    samples = 0
+    with open(source, "rb") as f:
+        for frame in decoder.feed(f.read()):
+            stream, seq, payload = frame
+            if stream == STREAM_META and decode_meta(payload):
+                fs = decode_meta(payload)[0]
+            elif stream == STREAM_FILTERED:
+                samples += len(payload)
+            recorder.write([frame], samples / fs)
+    recorder.close()
+    return decoder.errors
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Grabaciones de tramas del ECG")
+    commands = parser.add_subparsers(dest="command", required=True)
+    info = commands.add_parser("info", help="resumen de una grabacion")
+    info.add_argument("path")
+    capture = commands.add_parser("import", help="pasa una captura binaria a grabacion")
+    capture.add_argument("source")
+    capture.add_argument("path")
+    args = parser.parse_args()
+
+    if args.command == "import":
+        errors = import_capture(args.source, args.path)
+        if errors:
+            print(f"{errors} tramas descartadas")
+    recording = Recording(args.path)
+    print(f"{args.path}: {recording.duration:.1f} s")
+    for stream in recording.streams:
+        t, seq, data, counts = recording.read(stream)
+        if len(counts) and counts.min() != counts.max():
+            print(f"  flujo {stream}: {data.shape[0]} tramas de {counts.min()} a {counts.max()} valores {data.dtype} ({counts.sum()} en total)")
+        else:
+            print(f"  flujo {stream}: {data.shape[0]} tramas de {data.shape[1]} valores {data.dtype}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
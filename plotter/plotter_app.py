@@ -1,4 +1,17 @@
+import argparse
+
 from ecg_plotter import ECGPlotter
+from ecg_record import REPLAY_SPEEDS, Recorder, Recording, Replayer, device_path
+
+parser = argparse.ArgumentParser(description="Plotter del ECG")
+parser.add_argument("--record", metavar="ARCHIVO", help="graba lo que llega por cada puerto (ARCHIVO-puerto)")
+parser.add_argument("--replay", metavar="ARCHIVO", action="append", default=[], help="reproduce una grabacion como otro dispositivo (se puede repetir)")
+parser.add_argument("--speed", type=float, default=1.0, choices=REPLAY_SPEEDS, help="velocidad de reproduccion (0 es sin esperas)")
+args = parser.parse_args()
 
-plotter = ECGPlotter(1200, 750)
-plotter.run()
\ No newline at end of file
+recorder_factory = (lambda name: Recorder(device_path(args.record, name))) if args.record else None
+plotter = ECGPlotter(1200, 750, recorder_factory=recorder_factory)
+for path in args.replay:
+    recording = Recording(path)
+    plotter.add_source(path, lambda ring, recording=recording: Replayer(recording, ring, args.speed))
+plotter.run()
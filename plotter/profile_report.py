@@ -0,0 +1,42 @@
+import sys
+import serial
+
+from ecg_plotter import FrameDecoder, STREAM_PROFILE, profile_table
+
+# Muestra los tiempos por etapa que manda el firmware, desde un puerto serie
+# o desde una captura binaria (por ejemplo la salida de ecg_replay):
+#
+#   python profile_report.py /dev/ttyACM0
+#   python profile_report.py ecg.bin
+
+def main(source):
+    decoder = FrameDecoder()
+    if source.startswith("/dev/") or source.upper().startswith("COM"):
+        # Puerto serie: una tabla por reporte hasta Ctrl+C
+        with serial.Serial(source, 115200, timeout=1) as port:
+            while True:
+                for stream, seq, payload in decoder.feed(port.read(port.in_waiting or 1)):
+                    if stream == STREAM_PROFILE:
+                        print(f"\nVentana {seq}\n{profile_table(payload)}", flush=True)
+    else:
+        # Captura: solo el ultimo reporte
+        last = None
+        with open(source, "rb") as f:
+            for stream, seq, payload in decoder.feed(f.read()):
+                if stream == STREAM_PROFILE:
+                    last = (seq, payload)
+        if last is None:
+            print("No hay tramas de tiempos en la captura")
+            return 1
+        print(f"Ventana {last[0]}\n{profile_table(last[1])}")
+    return 0
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 2:
+        print("uso: python profile_report.py <puerto o captura>")
+        sys.exit(1)
+    try:
+        sys.exit(main(sys.argv[1]))
+    except KeyboardInterrupt:
+        pass
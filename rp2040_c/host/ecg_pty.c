@@ -0,0 +1,139 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "app_tasks.h"
+#include "host_ecg.h"
+#include "host_pico.h"
+
+// Simula la placa en una pseudo terminal
+//
+// Corre el mismo lazo que main.c sobre el ECG sintetico y escribe las tramas
+// en el lado maestro de una pty. El lado esclavo (que se imprime al arrancar)
+// se abre como cualquier puerto serie, con el plotter o con ecg_ingest.py.
+// Lo que se escribe en la pty llega al firmware como los comandos por USB,
+// asi que la señal se genera con el reloj simulado (sigue a la fs que pida el
+// host). Por defecto corre en tiempo real; con -r se acelera (0 es sin
+// esperas, el limite pasa a ser quien lee la pty).
+
+// Conversiones que se pasan al ADC entre esperas
+#define PTY_PACE_SAMPLES    (SAMPLING_BLOCK_LEN * SAMPLING_OVERSAMPLE)
+
+// Prototipos privados
+static int pty_open(char *name, size_t len);
+static void pty_wait_until(const struct timespec *start, double seconds);
+
+/**
+ * @brief Programa principal
+ * @param argc cantidad de argumentos
+ * @param argv argumentos
+ * @return 0 si se pudo correr la simulacion
+*/
+int main(int argc, char **argv) {
+    double seconds = 0.0;
+    double rate = 1.0;
+    int opt;
+    while((opt = getopt(argc, argv, "s:r:")) != -1) {
+        switch(opt) {
+            case 's': seconds = atof(optarg); break;
+            case 'r': rate = atof(optarg); break;
+            default:
+                fprintf(stderr, "uso: %s [-s segundos (0 sin fin)] [-r velocidad (0 sin esperas)]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    // Abro la pty y aviso donde conectarse
+    char name[64];
+    int master = pty_open(name, sizeof(name));
+    if(master < 0) {
+        perror("pty");
+        return 1;
+    }
+    FILE *out = fdopen(master, "wb");
+    if(!out) {
+        perror("fdopen");
+        return 1;
+    }
+    printf("%s\n", name);
+    fflush(stdout);
+    host_pico_set_output(out);
+    host_pico_set_input(master);
+
+    // Arranco el firmware como en main.c (sin el PWM de prueba)
+    stdio_init_all();
+    app_init();
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t samples;
+    for(samples = 0; seconds <= 0.0 || host_time_seconds() < seconds; samples++) {
+        host_adc_push(host_ecg_counts(host_ecg_synthetic(host_time_seconds())));
+        host_ecg_run_firmware();
+        // Cada tanto mando lo acumulado y espero a que corresponda la proxima muestra
+        if(samples % PTY_PACE_SAMPLES == PTY_PACE_SAMPLES - 1) {
+            if(fflush(out) != 0) {
+                perror("pty");
+                break;
+            }
+            if(rate > 0.0) { pty_wait_until(&start, host_time_seconds() / rate); }
+        }
+    }
+    fflush(out);
+
+    // Resumen de la adquisicion
+    sampling_stats_t stats;
+    sampling_get_stats(&stats);
+    fprintf(stderr, "%lu conversiones, %lu bloques, %lu perdidos, %lu procesados\n",
+        (unsigned long) samples, (unsigned long) stats.blocks, (unsigned long) stats.dropped, (unsigned long) stats.processed);
+    fclose(out);
+    return 0;
+}
+
+/**
+ * @brief Abre una pty en modo crudo
+ * @param name devuelve la ruta del lado esclavo
+ * @param len largo de name
+ * @return descriptor del lado maestro o -1 si hubo un error
+*/
+static int pty_open(char *name, size_t len) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if(master < 0) { return -1; }
+    if(grantpt(master) != 0 || unlockpt(master) != 0 || ptsname_r(master, name, len) != 0) {
+        close(master);
+        return -1;
+    }
+    // Sin eco ni traduccion de fines de linea, las tramas son binarias
+    int slave = open(name, O_RDWR | O_NOCTTY);
+    if(slave < 0) {
+        close(master);
+        return -1;
+    }
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+    // Dejo el esclavo abierto para que el maestro no de error entre conexiones
+    return master;
+}
+
+/**
+ * @brief Espera hasta un instante relativo al arranque
+ * @param start instante de arranque
+ * @param seconds segundos desde el arranque
+*/
+static void pty_wait_until(const struct timespec *start, double seconds) {
+    struct timespec until = *start;
+    until.tv_sec += (time_t) seconds;
+    until.tv_nsec += (long) ((seconds - (time_t) seconds) * 1e9);
+    if(until.tv_nsec >= 1000000000L) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR) { }
+}
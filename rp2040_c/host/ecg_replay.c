@@ -0,0 +1,134 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "app_tasks.h"
+#include "host_ecg.h"
+#include "host_pico.h"
+
+// Corre el firmware en PC sobre un ECG grabado o sintetico
+//
+// Las tramas que mandaria por USB van al archivo de salida (stdout por
+// defecto), asi se pueden decodificar con el plotter o compararlas entre
+// compilaciones. El archivo de entrada tiene una muestra por linea en volts
+// (si hay mas columnas separadas por coma se usa la primera).
+//
+// El ADC convierte SAMPLING_OVERSAMPLE veces por muestra: cada conversion toma
+// la señal en el instante del reloj simulado, interpolando entre las lineas
+// del archivo, y con -n se le suma ruido gaussiano del ADC en cuentas rms
+// para ver cuanto lo baja el diezmado.
+
+// Duracion por defecto del ECG sintetico en segundos
+#define REPLAY_SECONDS      10.0
+
+// Instante del reloj simulado en el que arranca la primera muestra
+static double replay_start;
+
+// Prototipos privados
+static void replay_convert(double sample, float v0, float v1, float noise);
+static float replay_gaussian(void);
+
+/**
+ * @brief Programa principal
+ * @param argc cantidad de argumentos
+ * @param argv argumentos
+ * @return 0 si se pudo correr la simulacion
+*/
+int main(int argc, char **argv) {
+    const char *input = NULL;
+    const char *output = NULL;
+    double seconds = REPLAY_SECONDS;
+    float noise = 0.0f;
+    int opt;
+    while((opt = getopt(argc, argv, "i:o:s:n:")) != -1) {
+        switch(opt) {
+            case 'i': input = optarg; break;
+            case 'o': output = optarg; break;
+            case 's': seconds = atof(optarg); break;
+            case 'n': noise = atof(optarg); break;
+            default:
+                fprintf(stderr, "uso: %s [-i ecg.csv] [-s segundos] [-n cuentas] [-o salida.bin]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    // Abro los archivos
+    FILE *in = NULL;
+    if(input && !(in = fopen(input, "r"))) {
+        perror(input);
+        return 1;
+    }
+    FILE *out = stdout;
+    if(output && !(out = fopen(output, "wb"))) {
+        perror(output);
+        return 1;
+    }
+    host_pico_set_output(out);
+
+    // Arranco el firmware como en main.c (sin el PWM de prueba)
+    stdio_init_all();
+    app_init();
+    replay_start = host_time_seconds();
+
+    // Paso las muestras de a una por el ADC simulado
+    uint32_t samples = 0;
+    if(in) {
+        // Interpolo cada muestra con la siguiente, asi que leo una linea adelantada
+        char line[128];
+        float volts = 0.0f;
+        bool valid = false;
+        while(fgets(line, sizeof(line), in)) {
+            char *end;
+            float next = strtof(line, &end);
+            if(end == line) { continue; }
+            if(valid) { replay_convert(samples++, volts, next, noise); }
+            volts = next;
+            valid = true;
+        }
+        if(valid) { replay_convert(samples++, volts, volts, noise); }
+        fclose(in);
+    }
+    else {
+        for(; samples < seconds * FS; samples++) {
+            replay_convert(samples, host_ecg_synthetic(samples / FS), host_ecg_synthetic((samples + 1) / FS), noise);
+        }
+    }
+
+    // Resumen de la adquisicion
+    sampling_stats_t stats;
+    sampling_get_stats(&stats);
+    fprintf(stderr, "%u muestras, %lu bloques, %lu perdidos, %lu procesados\n",
+        samples, (unsigned long) stats.blocks, (unsigned long) stats.dropped, (unsigned long) stats.processed);
+    if(out != stdout) { fclose(out); }
+    return 0;
+}
+
+/**
+ * @brief Hace las conversiones del ADC que caen en una muestra y corre el firmware
+ * @param sample numero de muestra (en periodos de FS)
+ * @param v0 tension al principio de la muestra
+ * @param v1 tension al principio de la siguiente
+ * @param noise ruido del ADC en cuentas rms
+*/
+static void replay_convert(double sample, float v0, float v1, float noise) {
+    // El reloj simulado avanza con cada conversion, convierto hasta llegar a la proxima muestra
+    double t;
+    while((t = (host_time_seconds() - replay_start) * FS - sample) < 1.0 - 1e-6) {
+        const float frac = (t < 0.0)? 0.0f : (float) t;
+        const float volts = v0 + (v1 - v0) * frac + noise * ADC_VOLTS_PER_COUNT * replay_gaussian();
+        if(!host_adc_push(host_ecg_counts(volts))) { break; }
+        host_ecg_run_firmware();
+    }
+}
+
+/**
+ * @brief Ruido gaussiano de varianza 1 (Box-Muller, con semilla fija para que las corridas se repitan)
+ * @return muestra de ruido
+*/
+static float replay_gaussian(void) {
+    const double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    const double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * PI * u2);
+}
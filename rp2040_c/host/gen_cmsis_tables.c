@@ -0,0 +1,332 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "arm_math.h"
+#include "arm_common_tables.h"
+
+// Genera arm_common_tables.c para la compilacion en PC
+//
+// El CMSIS-DSP de lib/ no trae arm_common_tables.c (el firmware lo toma del
+// paquete de la plataforma). Las tablas de twiddles salen de las formulas de
+// la documentacion de CMSIS y las de bit reversal de medir en que posicion deja
+// cada bin la CFFT sin reordenar.
+
+#define PI2 (2.0 * M_PI)
+
+// Largos de CFFT soportados
+static const uint32_t lens[] = {16, 32, 64, 128, 256, 512, 1024, 2048, 4096};
+#define NLENS (sizeof(lens) / sizeof(lens[0]))
+
+/**
+ * @brief Pasa a q31 con saturacion
+ * @param x valor en [-1, 1)
+ * @return valor en q31
+*/
+static int32_t to_q31(double x) {
+    double v = round(x * 2147483648.0);
+    if(v > 2147483647.0) { v = 2147483647.0; }
+    if(v < -2147483648.0) { v = -2147483648.0; }
+    return (int32_t) v;
+}
+
+/**
+ * @brief Pasa a q15 con saturacion
+ * @param x valor en [-1, 1)
+ * @return valor en q15
+*/
+static int16_t to_q15(double x) {
+    double v = round(x * 32768.0);
+    if(v > 32767.0) { v = 32767.0; }
+    if(v < -32768.0) { v = -32768.0; }
+    return (int16_t) v;
+}
+
+/**
+ * @brief Imprime una tabla float32_t
+ * @param name nombre de la tabla
+ * @param v puntero a valores
+ * @param n cantidad de valores
+*/
+static void print_f32(const char *name, const double *v, uint32_t n) {
+    printf("const float32_t %s[%u] = {\n", name, n);
+    for(uint32_t i = 0; i < n; i++) { printf("%.9ef,%s", v[i], (i % 8 == 7)? "\n" : " "); }
+    printf("};\n\n");
+}
+
+/**
+ * @brief Imprime una tabla float64_t como patrones de bits (asi no se pierde precision)
+ * @param name nombre de la tabla
+ * @param v puntero a valores
+ * @param n cantidad de valores
+*/
+static void print_f64(const char *name, const double *v, uint32_t n) {
+    printf("const uint64_t %s[%u] = {\n", name, n);
+    for(uint32_t i = 0; i < n; i++) {
+        uint64_t bits;
+        memcpy(&bits, &v[i], sizeof(bits));
+        printf("0x%016llxULL,%s", (unsigned long long) bits, (i % 4 == 3)? "\n" : " ");
+    }
+    printf("};\n\n");
+}
+
+/**
+ * @brief Imprime una tabla q31_t
+ * @param name nombre de la tabla
+ * @param v puntero a valores
+ * @param n cantidad de valores
+*/
+static void print_q31(const char *name, const double *v, uint32_t n) {
+    printf("const q31_t %s[%u] = {\n", name, n);
+    for(uint32_t i = 0; i < n; i++) { printf("(q31_t)0x%08X,%s", (uint32_t) to_q31(v[i]), (i % 8 == 7)? "\n" : " "); }
+    printf("};\n\n");
+}
+
+/**
+ * @brief Imprime una tabla q15_t
+ * @param name nombre de la tabla
+ * @param v puntero a valores
+ * @param n cantidad de valores
+*/
+static void print_q15(const char *name, const double *v, uint32_t n) {
+    printf("const q15_t %s[%u] = {\n", name, n);
+    for(uint32_t i = 0; i < n; i++) { printf("(q15_t)0x%04X,%s", (uint16_t) to_q15(v[i]), (i % 8 == 7)? "\n" : " "); }
+    printf("};\n\n");
+}
+
+/**
+ * @brief Imprime una tabla de bit reversal
+ * @param name nombre de la tabla
+ * @param len_macro macro con el largo declarado en arm_common_tables.h
+ * @param v puntero a valores
+ * @param n cantidad de valores
+*/
+static void print_u16(const char *name, const char *len_macro, const uint16_t *v, uint32_t n) {
+    printf("const uint16_t %s[%s] = {\n", name, len_macro);
+    for(uint32_t i = 0; i < n; i++) { printf("%u,%s", v[i], (i % 12 == 11)? "\n" : " "); }
+    printf("};\n\n");
+}
+
+/**
+ * @brief Twiddles de la CFFT: cos y sin de 2 * pi * i / n
+ * @param v puntero a destino (pares cos, sin)
+ * @param n largo de la CFFT
+ * @param count cantidad de pares
+*/
+static void twiddles(double *v, uint32_t n, uint32_t count) {
+    for(uint32_t i = 0; i < count; i++) {
+        v[2 * i] = cos(PI2 * i / n);
+        v[2 * i + 1] = sin(PI2 * i / n);
+    }
+}
+
+/**
+ * @brief Arma la lista de intercambios que lleva cada bin k de la posicion perm[k] a k
+ * @param perm puntero a permutacion
+ * @param n largo de la CFFT
+ * @param scale escala de los indices (bytes por bin complejo)
+ * @param table puntero a destino
+ * @param table_len largo de la tabla (se rellena con intercambios nulos)
+ * @return cantidad de valores escritos
+*/
+static uint32_t swaps_from_perm(const uint32_t *perm, uint32_t n, uint32_t scale, uint16_t *table, uint32_t table_len) {
+    static uint32_t at[4096];
+    static uint32_t pos[4096];
+    uint32_t count = 0;
+    // Que bin hay en cada posicion y en que posicion esta cada bin
+    for(uint32_t k = 0; k < n; k++) {
+        pos[k] = perm[k];
+        at[perm[k]] = k;
+    }
+    for(uint32_t i = 0; i < n; i++) {
+        if(at[i] == i) { continue; }
+        // Traigo el bin i a su lugar
+        uint32_t j = pos[i];
+        if(count + 2 > table_len) {
+            fprintf(stderr, "tabla de bit reversal muy larga en N=%u\n", n);
+            exit(1);
+        }
+        table[count++] = i * scale;
+        table[count++] = j * scale;
+        uint32_t moved = at[i];
+        at[j] = moved;
+        pos[moved] = j;
+        at[i] = i;
+        pos[i] = i;
+    }
+    // Relleno con intercambios nulos
+    while(count < table_len) { table[count++] = 0; }
+    return count;
+}
+
+/**
+ * @brief Largo de cada tabla de bit reversal segun arm_common_tables.h
+ * @param n largo de la CFFT
+ * @param kind 0 punto fijo, 1 f64, 2 f32
+ * @return largo de la tabla
+*/
+static uint32_t table_len(uint32_t n, int kind) {
+#define TABLE_LEN(N) case N: return (kind == 0)? ARMBITREVINDEXTABLE_FIXED_##N##_TABLE_LENGTH : \
+    (kind == 1)? ARMBITREVINDEXTABLEF64_##N##_TABLE_LENGTH : ARMBITREVINDEXTABLE_##N##_TABLE_LENGTH;
+    switch(n) {
+        TABLE_LEN(16) TABLE_LEN(32) TABLE_LEN(64) TABLE_LEN(128) TABLE_LEN(256)
+        TABLE_LEN(512) TABLE_LEN(1024) TABLE_LEN(2048) TABLE_LEN(4096)
+    }
+#undef TABLE_LEN
+    return 0;
+}
+
+/**
+ * @brief Invierte el orden de los bits
+ * @param x valor
+ * @param bits cantidad de bits
+ * @return valor invertido
+*/
+static uint32_t bit_reverse(uint32_t x, uint32_t bits) {
+    uint32_t r = 0;
+    for(uint32_t b = 0; b < bits; b++) { r = (r << 1) | ((x >> b) & 1); }
+    return r;
+}
+
+/**
+ * @brief Mide la permutacion de la CFFT f32 sin reordenar
+ * @param n largo de la CFFT
+ * @param tw puntero a twiddles
+ * @param perm puntero a destino (posicion de cada bin)
+*/
+static void cfft_f32_perm(uint32_t n, const float32_t *tw, uint32_t *perm) {
+    float32_t *buf = malloc(2 * n * sizeof(float32_t));
+    arm_cfft_instance_f32 s = { (uint16_t) n, tw, NULL, 0 };
+    for(uint32_t k = 0; k < n; k++) {
+        // Exponencial compleja de frecuencia k, la CFFT la lleva a un unico bin
+        for(uint32_t i = 0; i < n; i++) {
+            buf[2 * i] = cos(PI2 * k * i / n);
+            buf[2 * i + 1] = sin(PI2 * k * i / n);
+        }
+        arm_cfft_f32(&s, buf, 0, 0);
+        uint32_t best = 0;
+        float32_t best_mag = 0;
+        for(uint32_t i = 0; i < n; i++) {
+            float32_t m = buf[2 * i] * buf[2 * i] + buf[2 * i + 1] * buf[2 * i + 1];
+            if(m > best_mag) { best_mag = m; best = i; }
+        }
+        perm[k] = best;
+    }
+    free(buf);
+}
+
+/**
+ * @brief Genera las tablas
+ * @param argc cantidad de argumentos
+ * @param argv argv[1] es el archivo de salida (stdout si no esta)
+ * @return 0 si se pudo escribir
+*/
+int main(int argc, char **argv) {
+    static double v[16384];
+    static float32_t tw[8192];
+    static uint32_t perm[4096];
+    static uint16_t table[8192];
+    char name[64];
+    char macro[96];
+
+    // Escribo en el archivo pedido
+    if(argc > 1 && !freopen(argv[1], "w", stdout)) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    printf("/* Generado por gen_cmsis_tables.c, no editar */\n\n");
+    printf("#include \"arm_math_types.h\"\n#include \"arm_common_tables.h\"\n\n");
+
+    for(uint32_t l = 0; l < NLENS; l++) {
+        uint32_t n = lens[l];
+        uint32_t bits = 0;
+        while((1u << bits) < n) { bits++; }
+
+        // Twiddles de punto flotante (N complejos)
+        twiddles(v, n, n);
+        snprintf(name, sizeof(name), "twiddleCoef_%u", n);
+        print_f32(name, v, 2 * n);
+        snprintf(name, sizeof(name), "twiddleCoefF64_%u", n);
+        print_f64(name, v, 2 * n);
+        for(uint32_t i = 0; i < 2 * n; i++) { tw[i] = v[i]; }
+
+        // Twiddles de punto fijo (3N/4 complejos)
+        twiddles(v, n, 3 * n / 4);
+        snprintf(name, sizeof(name), "twiddleCoef_%u_q31", n);
+        print_q31(name, v, 3 * n / 2);
+        snprintf(name, sizeof(name), "twiddleCoef_%u_q15", n);
+        print_q15(name, v, 3 * n / 2);
+
+        // Twiddles de la RFFT (N/2 pares seno, coseno)
+        if(n >= 32) {
+            for(uint32_t i = 0; i < n / 2; i++) {
+                v[2 * i] = sin(PI2 * i / n);
+                v[2 * i + 1] = cos(PI2 * i / n);
+            }
+            snprintf(name, sizeof(name), "twiddleCoef_rfft_%u", n);
+            print_f32(name, v, n);
+            snprintf(name, sizeof(name), "twiddleCoefF64_rfft_%u", n);
+            print_f64(name, v, n);
+        }
+
+        // Bit reversal de punto fijo y f64: inversion de bits pura
+        for(uint32_t i = 0; i < n; i++) { perm[i] = bit_reverse(i, bits); }
+        snprintf(macro, sizeof(macro), "ARMBITREVINDEXTABLE_FIXED_%u_TABLE_LENGTH", n);
+        snprintf(name, sizeof(name), "armBitRevIndexTable_fixed_%u", n);
+        print_u16(name, macro, table, swaps_from_perm(perm, n, 8, table, table_len(n, 0)));
+        snprintf(macro, sizeof(macro), "ARMBITREVINDEXTABLEF64_%u_TABLE_LENGTH", n);
+        snprintf(name, sizeof(name), "armBitRevIndexTableF64_%u", n);
+        print_u16(name, macro, table, swaps_from_perm(perm, n, 8, table, table_len(n, 1)));
+
+        // Bit reversal de f32: depende de la descomposicion radix 8
+        cfft_f32_perm(n, tw, perm);
+        snprintf(macro, sizeof(macro), "ARMBITREVINDEXTABLE_%u_TABLE_LENGTH", n);
+        snprintf(name, sizeof(name), "armBitRevIndexTable%u", n);
+        print_u16(name, macro, table, swaps_from_perm(perm, n, 8, table, table_len(n, 2)));
+    }
+
+    // Coeficientes de separacion de la RFFT de punto fijo (N = 4096)
+    for(uint32_t i = 0; i < 4096; i++) {
+        v[2 * i] = 0.5 * (1.0 - sin(PI2 * i / 8192));
+        v[2 * i + 1] = 0.5 * (-1.0 * cos(PI2 * i / 8192));
+    }
+    print_q31("realCoefAQ31", v, 8192);
+    print_q15("realCoefAQ15", v, 8192);
+    print_f32("realCoefA", v, 8192);
+    for(uint32_t i = 0; i < 4096; i++) {
+        v[2 * i] = 0.5 * (1.0 + sin(PI2 * i / 8192));
+        v[2 * i + 1] = 0.5 * (1.0 * cos(PI2 * i / 8192));
+    }
+    print_q31("realCoefBQ31", v, 8192);
+    print_q15("realCoefBQ15", v, 8192);
+    print_f32("realCoefB", v, 8192);
+
+    // Tablas de seno para las funciones rapidas
+    for(uint32_t i = 0; i <= FAST_MATH_TABLE_SIZE; i++) { v[i] = sin(PI2 * i / FAST_MATH_TABLE_SIZE); }
+    print_f32("sinTable_f32", v, FAST_MATH_TABLE_SIZE + 1);
+    print_q31("sinTable_q31", v, FAST_MATH_TABLE_SIZE + 1);
+    print_q15("sinTable_q15", v, FAST_MATH_TABLE_SIZE + 1);
+
+    // Valores iniciales de 1 / x para Newton (LMS normalizados), x normalizado
+    // en [0.5, 1) y el resultado dividido por 2
+    for(uint32_t i = 0; i < 64; i++) { v[i] = 64.0 / (64.0 + i + 0.5); }
+    print_q31("armRecipTableQ31", v, 64);
+    print_q15("armRecipTableQ15", v, 64);
+
+    // Valores iniciales de 1 / sqrt(x) para Newton, x normalizado en [0.25, 1)
+    printf("const q31_t sqrt_initial_lut_q31[32] = {\n");
+    for(uint32_t i = 0; i < 32; i++) {
+        double x = (i + 8.5) / 32.0;
+        printf("%ld,%s", lround((1 << 28) / sqrt(x)), (i % 8 == 7)? "\n" : " ");
+    }
+    printf("};\n\n");
+    printf("const q15_t sqrt_initial_lut_q15[16] = {\n");
+    for(uint32_t i = 0; i < 16; i++) {
+        double x = (i + 4.5) / 16.0;
+        printf("%ld,%s", lround((1 << 12) / sqrt(x)), (i % 8 == 7)? "\n" : " ");
+    }
+    printf("};\n\n");
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include <math.h>
+
+#include "app_tasks.h"
+#include "host_ecg.h"
+
+/**
+ * @brief ECG sintetico: ondas P, Q, R, S y T gaussianas, deriva de linea de base y 50 Hz
+ * @param t tiempo en segundos
+ * @return tension en volts
+*/
+float host_ecg_synthetic(double t) {
+    // Fase dentro del latido
+    const double phase = fmod(t, HOST_ECG_BEAT_S) / HOST_ECG_BEAT_S;
+    // Centro, ancho y amplitud de cada onda
+    static const double waves[][3] = {
+        { 0.15, 0.025, 0.10 },
+        { 0.27, 0.010, -0.10 },
+        { 0.30, 0.012, 0.60 },
+        { 0.33, 0.010, -0.15 },
+        { 0.60, 0.050, 0.20 },
+    };
+    double v = ADC_VREF / 2;
+    for(uint32_t i = 0; i < sizeof(waves) / sizeof(waves[0]); i++) {
+        double x = (phase - waves[i][0]) / waves[i][1];
+        v += waves[i][2] * exp(-x * x);
+    }
+    v += 0.05 * sin(2 * PI * 0.3 * t);
+    v += HOST_ECG_MAINS_V * sin(2 * PI * 50.0 * t);
+    return v;
+}
+
+/**
+ * @brief Pasa volts a cuentas del ADC con saturacion
+ * @param volts tension
+ * @return cuenta de 12 bits
+*/
+uint16_t host_ecg_counts(float volts) {
+    long count = lroundf(volts / ADC_VOLTS_PER_COUNT);
+    if(count < 0) { count = 0; }
+    if(count > ADC_MAX_COUNT) { count = ADC_MAX_COUNT; }
+    return count;
+}
+
+/**
+ * @brief Corre el lazo principal de main.c hasta que no quede trabajo
+*/
+void host_ecg_run_firmware(void) {
+#if !APP_DUAL_CORE
+    while(app_dsp_task()) { }
+#endif
+    while(app_send_task()) { }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+// ECG sintetico y conversion a cuentas para los programas de la compilacion en PC
+
+// Periodo de latido del ECG sintetico en segundos
+#define HOST_ECG_BEAT_S     0.8
+// Amplitud del ruido de linea del ECG sintetico en volts
+#define HOST_ECG_MAINS_V    0.2
+
+// Prototipos de funciones
+float host_ecg_synthetic(double t);
+uint16_t host_ecg_counts(float volts);
+void host_ecg_run_firmware(void);
@@ -0,0 +1,329 @@
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "host_pico.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "pico/multicore.h"
+#include "pico/stdio_usb.h"
+
+// Reloj del ADC en Hz
+#define HOST_ADC_CLK_HZ     48000000.0
+// Cantidad de interrupciones simuladas
+#define HOST_IRQ_COUNT      32
+// Microsegundos simulados entre lecturas de la entrada cuando no llega nada
+#define HOST_INPUT_POLL_US  1000.0
+
+// Estado de un canal de DMA
+typedef struct {
+    bool claimed;
+    bool busy;
+    bool irq0;
+    dma_channel_config config;
+    volatile uint16_t *write_addr;
+    volatile uint16_t *cursor;
+    uint32_t transfer_count;
+    uint32_t remaining;
+} host_dma_channel_t;
+
+// Variables privadas
+
+// Registros simulados
+static adc_hw_t adc_regs;
+static dma_hw_t dma_regs;
+adc_hw_t *adc_hw = &adc_regs;
+dma_hw_t *dma_hw = &dma_regs;
+// Canales de DMA
+static host_dma_channel_t dma_channels[NUM_DMA_CHANNELS];
+// Rutinas de interrupcion y habilitaciones
+static irq_handler_t irq_handlers[HOST_IRQ_COUNT];
+static bool irq_enabled[HOST_IRQ_COUNT];
+// Estado del ADC
+static bool adc_running = false;
+static bool adc_dreq = false;
+static float adc_clkdiv = 0.0f;
+// Reloj simulado en us (con fraccion para no acumular error)
+static double now_us = 0.0;
+// Destino de putchar_raw
+static FILE *output = NULL;
+// Origen de getchar_timeout_us (-1 sin entrada), bytes leidos y ultima lectura vacia
+static int input = -1;
+static uint8_t input_buffer[64];
+static uint32_t input_len = 0;
+static uint32_t input_pos = 0;
+static double input_poll_us = -HOST_INPUT_POLL_US;
+
+// Prototipos privados
+static void host_dma_trigger(uint channel);
+static void *host_core1_thread(void *entry);
+
+/**
+ * @brief Elige a donde va la salida del USB
+ * @param out archivo de salida (stdout si es NULL)
+*/
+void host_pico_set_output(FILE *out) {
+    output = out;
+}
+
+/**
+ * @brief Elige de donde llega la entrada del USB
+ * @param fd descriptor de entrada (-1 para no leer nada)
+*/
+void host_pico_set_input(int fd) {
+    input = fd;
+}
+
+/**
+ * @brief Simula una conversion del ADC
+ * @param count cuenta del ADC (12 bits)
+ * @return devuelve false si no habia un canal de DMA activo
+*/
+bool host_adc_push(uint16_t count) {
+    if(!adc_running) { return false; }
+    // Cada conversion toma (1 + div) ciclos, con un minimo de 96
+    double cycles = 1.0 + adc_clkdiv;
+    now_us += 1e6 * ((cycles < 96.0)? 96.0 : cycles) / HOST_ADC_CLK_HZ;
+    if(!adc_dreq) { return false; }
+    // Busco el canal que esta pidiendo el ADC
+    for(uint i = 0; i < NUM_DMA_CHANNELS; i++) {
+        host_dma_channel_t *ch = &dma_channels[i];
+        if(!ch->busy || ch->config.dreq != DREQ_ADC) { continue; }
+        *ch->cursor = count & 0x0FFF;
+        if(ch->config.write_increment) { ch->cursor++; }
+        if(--ch->remaining > 0) { return true; }
+        // Termino el bloque, encadeno y aviso
+        ch->busy = false;
+        if(ch->config.chain_to != i) { host_dma_trigger(ch->config.chain_to); }
+        if(ch->irq0) {
+            dma_regs.ints0 |= 1u << i;
+            if(irq_enabled[DMA_IRQ_0] && irq_handlers[DMA_IRQ_0]) { irq_handlers[DMA_IRQ_0](); }
+            dma_regs.ints0 &= ~(1u << i);
+        }
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Avanza el reloj simulado
+ * @param us microsegundos
+*/
+void host_time_advance_us(uint64_t us) {
+    now_us += us;
+}
+
+/**
+ * @brief Reloj simulado
+ * @return segundos desde el arranque
+*/
+double host_time_seconds(void) {
+    return now_us / 1e6;
+}
+
+bool stdio_init_all(void) {
+    return true;
+}
+
+void sleep_ms(uint32_t ms) {
+    now_us += 1000.0 * ms;
+}
+
+uint64_t time_us_64(void) {
+    return (uint64_t) now_us;
+}
+
+uint32_t time_us_32(void) {
+    return (uint32_t) now_us;
+}
+
+int putchar_raw(int c) {
+    return fputc(c, output? output : stdout);
+}
+
+/**
+ * @brief Lee un byte de la entrada sin esperar (el timeout se ignora)
+ * @param timeout_us tiempo de espera
+ * @return byte leido o PICO_ERROR_TIMEOUT
+*/
+int getchar_timeout_us(uint32_t timeout_us) {
+    (void) timeout_us;
+    if(input_pos < input_len) { return input_buffer[input_pos++]; }
+    // Sin nada pendiente solo vuelvo a mirar el descriptor cada tanto (es una llamada al sistema)
+    if(input < 0 || now_us - input_poll_us < HOST_INPUT_POLL_US) { return PICO_ERROR_TIMEOUT; }
+    struct pollfd pfd = { .fd = input, .events = POLLIN };
+    ssize_t len = (poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN))? read(input, input_buffer, sizeof(input_buffer)) : 0;
+    if(len <= 0) {
+        input_poll_us = now_us;
+        return PICO_ERROR_TIMEOUT;
+    }
+    input_len = len;
+    input_pos = 1;
+    return input_buffer[0];
+}
+
+void tight_loop_contents(void) {
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn) {
+    (void) gpio;
+    (void) fn;
+}
+
+bool stdio_usb_connected(void) {
+    return true;
+}
+
+/**
+ * @brief Corre el nucleo 1 en un hilo
+ * @param entry funcion de entrada del nucleo 1
+*/
+void multicore_launch_core1(void (*entry)(void)) {
+    static pthread_t thread;
+    if(pthread_create(&thread, NULL, host_core1_thread, (void*) entry) != 0) { abort(); }
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+    irq_handlers[num] = handler;
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+    irq_enabled[num] = enabled;
+}
+
+void adc_init(void) {
+    adc_running = false;
+    adc_dreq = false;
+}
+
+void adc_gpio_init(uint gpio) {
+    (void) gpio;
+}
+
+void adc_select_input(uint input) {
+    (void) input;
+}
+
+void adc_set_round_robin(uint input_mask) {
+    (void) input_mask;
+}
+
+void adc_fifo_setup(bool en, bool dreq_en, uint16_t dreq_thresh, bool err_in_fifo, bool byte_shift) {
+    (void) dreq_thresh;
+    (void) err_in_fifo;
+    (void) byte_shift;
+    adc_dreq = en && dreq_en;
+}
+
+void adc_set_clkdiv(float clkdiv) {
+    adc_clkdiv = clkdiv;
+}
+
+void adc_run(bool run) {
+    adc_running = run;
+}
+
+void adc_fifo_drain(void) {
+}
+
+int dma_claim_unused_channel(bool required) {
+    for(uint i = 0; i < NUM_DMA_CHANNELS; i++) {
+        if(!dma_channels[i].claimed) {
+            dma_channels[i].claimed = true;
+            return i;
+        }
+    }
+    if(required) { abort(); }
+    return -1;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    // Sin encadenar (apunta a si mismo), de 32 bits, lee incrementando
+    dma_channel_config c = {
+        .chain_to = channel,
+        .dreq = 0x3F,
+        .size = DMA_SIZE_32,
+        .read_increment = true,
+        .write_increment = false,
+    };
+    return c;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+    c->size = size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+    c->read_increment = incr;
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+    c->write_increment = incr;
+}
+
+void channel_config_set_dreq(dma_channel_config *c, uint dreq) {
+    c->dreq = dreq;
+}
+
+void channel_config_set_chain_to(dma_channel_config *c, uint chain_to) {
+    c->chain_to = chain_to;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr, const volatile void *read_addr, uint transfer_count, bool trigger) {
+    // Solo se simulan transferencias de 16 bits desde el FIFO del ADC
+    (void) read_addr;
+    host_dma_channel_t *ch = &dma_channels[channel];
+    ch->config = *config;
+    ch->write_addr = write_addr;
+    ch->transfer_count = transfer_count;
+    if(trigger) { host_dma_trigger(channel); }
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled) {
+    dma_channels[channel].irq0 = enabled;
+}
+
+void dma_channel_set_write_addr(uint channel, volatile void *write_addr, bool trigger) {
+    dma_channels[channel].write_addr = write_addr;
+    if(trigger) { host_dma_trigger(channel); }
+}
+
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger) {
+    dma_channels[channel].transfer_count = trans_count;
+    if(trigger) { host_dma_trigger(channel); }
+}
+
+void dma_channel_start(uint channel) {
+    host_dma_trigger(channel);
+}
+
+void dma_channel_abort(uint channel) {
+    dma_channels[channel].busy = false;
+}
+
+void dma_channel_acknowledge_irq0(uint channel) {
+    dma_regs.ints0 &= ~(1u << channel);
+}
+
+/**
+ * @brief Arranca un canal desde su direccion de escritura con el contador recargado
+ * @param channel canal de DMA
+*/
+static void host_dma_trigger(uint channel) {
+    host_dma_channel_t *ch = &dma_channels[channel];
+    ch->cursor = ch->write_addr;
+    ch->remaining = ch->transfer_count;
+    ch->busy = true;
+}
+
+/**
+ * @brief Hilo del nucleo 1
+ * @param entry funcion de entrada del nucleo 1
+ * @return nunca vuelve
+*/
+static void *host_core1_thread(void *entry) {
+    ((void (*)(void)) entry)();
+    return NULL;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "pico/stdlib.h"
+
+// Simulacion del RP2040 para la compilacion en PC
+//
+// El ADC no convierte solo: cada llamada a host_adc_push es una conversion.
+// La muestra pasa al canal de DMA activo, el reloj avanza un periodo del ADC
+// ((1 + clkdiv) / 48 MHz) y al terminar un bloque se encadena el otro canal
+// y se llama a la interrupcion registrada, igual que en la placa. Lo que
+// entra por el USB (getchar_timeout_us) se lee de un descriptor sin esperar.
+
+// Prototipos de funciones
+void host_pico_set_output(FILE *out);
+void host_pico_set_input(int fd);
+bool host_adc_push(uint16_t count);
+void host_time_advance_us(uint64_t us);
+double host_time_seconds(void);
@@ -0,0 +1,33 @@
+# Suma data + bss de los objetos del firmware y falla si pasa el presupuesto
+#
+#   cmake -DSIZE_TOOL=size -DARCHIVE=libecg_firmware.a -DBUDGET=237568 -P ram_budget.cmake
+#
+# Los objetos de la simulacion (host_*) no van a la placa y no se cuentan. En
+# PC los punteros de las instancias de CMSIS miden 8 bytes en lugar de 4, asi
+# que la suma queda un poco por encima de la del RP2040.
+
+execute_process(COMMAND ${SIZE_TOOL} ${ARCHIVE} OUTPUT_VARIABLE sizes RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${SIZE_TOOL} ${ARCHIVE} fallo")
+endif()
+
+string(REPLACE "\n" ";" lines "${sizes}")
+set(total 0)
+foreach(line IN LISTS lines)
+    # text data bss dec hex objeto
+    if(line MATCHES "^[ \t]*[0-9]+[ \t]+([0-9]+)[ \t]+([0-9]+)[ \t]+[0-9]+[ \t]+[0-9a-f]+[ \t]+([^ \t]+)")
+        set(data ${CMAKE_MATCH_1})
+        set(bss ${CMAKE_MATCH_2})
+        set(object ${CMAKE_MATCH_3})
+        if(NOT object MATCHES "^host_")
+            math(EXPR total "${total} + ${data} + ${bss}")
+        endif()
+    endif()
+endforeach()
+
+math(EXPR total_kb "${total} / 1024")
+math(EXPR budget_kb "${BUDGET} / 1024")
+if(total GREATER BUDGET)
+    message(FATAL_ERROR "El firmware usa ${total_kb} kB de RAM estatica (${total} B), el presupuesto es ${budget_kb} kB (${BUDGET} B)")
+endif()
+message(STATUS "RAM estatica del firmware: ${total_kb} kB de ${budget_kb} kB")
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+// Canales de DMA
+#define NUM_DMA_CHANNELS    12
+// Pedido de DMA del ADC
+#define DREQ_ADC            36
+
+// Tamaño de cada transferencia
+enum dma_channel_transfer_size {
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2,
+};
+
+// Configuracion de un canal (solo lo que simula host_pico.c)
+typedef struct {
+    uint chain_to;
+    uint dreq;
+    enum dma_channel_transfer_size size;
+    bool read_increment;
+    bool write_increment;
+} dma_channel_config;
+
+// Registros de interrupcion (ints0 se limpia escribiendo 1 en el bit del canal)
+typedef struct {
+    volatile uint32_t intr;
+    volatile uint32_t inte0;
+    volatile uint32_t intf0;
+    volatile uint32_t ints0;
+} dma_hw_t;
+
+extern dma_hw_t *dma_hw;
+
+// Prototipos de funciones
+int dma_claim_unused_channel(bool required);
+dma_channel_config dma_channel_get_default_config(uint channel);
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size);
+void channel_config_set_read_increment(dma_channel_config *c, bool incr);
+void channel_config_set_write_increment(dma_channel_config *c, bool incr);
+void channel_config_set_dreq(dma_channel_config *c, uint dreq);
+void channel_config_set_chain_to(dma_channel_config *c, uint chain_to);
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr, const volatile void *read_addr, uint transfer_count, bool trigger);
+void dma_channel_set_irq0_enabled(uint channel, bool enabled);
+void dma_channel_set_write_addr(uint channel, volatile void *write_addr, bool trigger);
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger);
+void dma_channel_start(uint channel);
+void dma_channel_abort(uint channel);
+void dma_channel_acknowledge_irq0(uint channel);
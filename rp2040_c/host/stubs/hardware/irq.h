@@ -0,0 +1,14 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+// Interrupciones simuladas
+#define DMA_IRQ_0       11
+#define DMA_IRQ_1       12
+
+// Rutina de interrupcion
+typedef void (*irq_handler_t)(void);
+
+// Prototipos de funciones
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_set_enabled(uint num, bool enabled);
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+// Prototipos de funciones
+void multicore_launch_core1(void (*entry)(void));
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+// Prototipos de funciones
+bool stdio_usb_connected(void);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Reemplazo de pico/stdlib.h para la compilacion en PC (ver host/host_pico.c)
+
+typedef unsigned int uint;
+
+// Valor de getchar_timeout_us cuando no llego nada
+#define PICO_ERROR_TIMEOUT  (-1)
+
+// Funciones de GPIO
+enum gpio_function {
+    GPIO_FUNC_SIO = 5,
+    GPIO_FUNC_PWM = 4,
+};
+
+// Prototipos de funciones
+bool stdio_init_all(void);
+void sleep_ms(uint32_t ms);
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+int putchar_raw(int c);
+int getchar_timeout_us(uint32_t timeout_us);
+void tight_loop_contents(void);
+void gpio_set_function(uint gpio, enum gpio_function fn);
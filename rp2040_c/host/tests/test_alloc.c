@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "app_tasks.h"
+#include "host_ecg.h"
+#include "host_pico.h"
+#include "test_golden.h"
+
+// El camino de cada bloque no usa el heap
+//
+// Se enlaza con -Wl,--wrap de malloc, calloc, realloc y free, asi que cada
+// llamada desde el firmware (y desde CMSIS-DSP) pasa por los contadores de
+// aca. Despues de arrancar y de llenar la primera ventana no tiene que haber
+// ninguna mientras corre el ECG sintetico.
+
+// Segundos de arranque (primera ventana, PSD y HRV) y segundos medidos
+#define TEST_WARMUP_S       3.0
+#define TEST_MEASURE_S      5.0
+
+// Llamadas al heap desde el firmware
+static uint32_t heap_calls = 0;
+
+// Funciones reales que enlaza --wrap
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+// Prototipos privados
+static void test_run(double seconds);
+
+/**
+ * @brief Programa principal
+ * @return 0 si pasaron todos los casos
+*/
+int main(void) {
+    FILE *out = fopen("/dev/null", "wb");
+    host_pico_set_output(out);
+    stdio_init_all();
+    app_init();
+    test_run(TEST_WARMUP_S);
+    sampling_stats_t before;
+    sampling_get_stats(&before);
+    heap_calls = 0;
+    test_run(TEST_MEASURE_S);
+    sampling_stats_t after;
+    sampling_get_stats(&after);
+    host_pico_set_output(NULL);
+    fclose(out);
+    golden_expect(after.processed > before.processed, "heap", "no se proceso ningun bloque");
+    golden_expect(after.dropped == before.dropped, "heap", "se perdieron bloques");
+    if(!golden_expect(heap_calls == 0, "heap", "hubo llamadas al heap por bloque")) {
+        fprintf(stderr, "%u llamadas en %lu bloques\n", heap_calls, (unsigned long) (after.processed - before.processed));
+    }
+    else { printf("ok heap (%lu bloques sin reservas)\n", (unsigned long) (after.processed - before.processed)); }
+    return golden_result();
+}
+
+/**
+ * @brief Convierte el ECG sintetico en el ADC simulado y corre el firmware
+ * @param seconds segundos de reloj simulado
+*/
+static void test_run(double seconds) {
+    const double end = host_time_seconds() + seconds;
+    double t;
+    while((t = host_time_seconds()) < end) {
+        if(!host_adc_push(host_ecg_counts(host_ecg_synthetic(t)))) { break; }
+        host_ecg_run_firmware();
+    }
+}
+
+// Reemplazos que enlaza --wrap: cuentan la llamada y siguen con la real
+void *__wrap_malloc(size_t size) {
+    heap_calls++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    heap_calls++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    heap_calls++;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr) {
+    heap_calls++;
+    __real_free(ptr);
+}
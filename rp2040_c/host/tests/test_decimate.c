@@ -0,0 +1,184 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "app_tasks.h"
+#include "test_golden.h"
+
+// FIR de diezmado del ADC: antialiasing y bits efectivos del sobremuestreo
+//
+// Hace lo mismo que adc_dma_handler con 8 y con 32 conversiones por muestra:
+// dsp_lowpass_q15 con SAMPLING_DECIM_TAPS_PER_PHASE coeficientes por
+// conversion, dsp_counts_to_q15 y arm_fir_decimate_fast_q15 de a bloques de
+// SAMPLING_BLOCK_LEN muestras de salida. Dos casos por sobremuestreo:
+//   decimate_alias  tonos de fs / 2 hasta casi la mitad de la frecuencia del
+//                   ADC tienen que salir TEST_MIN_REJECTION_DB por debajo
+//   decimate_snr    un seno dentro de la banda con el ruido del ADC (medio
+//                   cuenta eficaz) y cuantizado a 12 bits: el ruido que queda
+//                   despues de ajustar el seno tiene que bajar respecto de
+//                   tomar una de cada SAMPLING_OVERSAMPLE conversiones, casi
+//                   10 * log10(sobremuestreo / (2 * SAMPLING_DECIM_CUTOFF))
+
+// Frecuencia de muestreo de salida
+#define TEST_FS             1000.0
+// Muestras de salida de arranque (el FIR mas largo se llena) y medidas
+#define TEST_SETTLE_LEN     64
+#define TEST_MEASURE_LEN    4096
+// Sobremuestreo maximo (largo de los buffers)
+#define TEST_OVERSAMPLE_MAX 32
+#define TEST_TAPS_MAX       (SAMPLING_DECIM_TAPS_PER_PHASE * TEST_OVERSAMPLE_MAX)
+// Amplitud de los tonos en cuentas
+#define TEST_TONE_COUNTS    1500.0
+// Seno de la banda: frecuencia y amplitud en cuentas, ruido del ADC en cuentas eficaces
+#define TEST_SIGNAL_HZ      10.3
+#define TEST_SIGNAL_COUNTS  400.0
+#define TEST_NOISE_COUNTS   0.5
+// Atenuacion minima de los tonos y ganancia de SNR admitida por debajo de la ideal
+#define TEST_MIN_REJECTION_DB   50.0
+#define TEST_SNR_MARGIN_DB      1.0
+
+// Diezmador y bloques de trabajo
+static arm_fir_decimate_instance_q15 decimator;
+static q15_t coeffs[TEST_TAPS_MAX];
+static q15_t state[TEST_TAPS_MAX + SAMPLING_BLOCK_LEN * TEST_OVERSAMPLE_MAX - 1];
+static uint16_t counts[SAMPLING_BLOCK_LEN * TEST_OVERSAMPLE_MAX];
+static q15_t input[SAMPLING_BLOCK_LEN * TEST_OVERSAMPLE_MAX];
+static float32_t decimated[TEST_MEASURE_LEN];
+static float32_t plain[TEST_MEASURE_LEN];
+// Generador del ruido (siempre la misma serie)
+static uint32_t seed = 12345;
+
+// Prototipos privados
+static void test_alias(uint32_t oversample, const char *name);
+static void test_snr(uint32_t oversample, const char *name);
+static void test_run(uint32_t oversample, double f, double amplitude, double noise);
+static double test_noise_power(const float32_t *src, double f, uint32_t len);
+static double test_gaussian(void);
+
+/**
+ * @brief Programa principal
+ * @return 0 si pasaron todos los casos
+*/
+int main(void) {
+    dsp_init();
+    test_alias(8, "decimate_alias_8");
+    test_snr(8, "decimate_snr_8");
+    test_alias(32, "decimate_alias_32");
+    test_snr(32, "decimate_snr_32");
+    return golden_result();
+}
+
+/**
+ * @brief Tonos por encima de fs / 2 contra la entrada
+ * @param oversample conversiones por muestra
+ * @param name nombre del caso
+*/
+static void test_alias(uint32_t oversample, const char *name) {
+    // Desde fs / 2 hasta la mitad de la frecuencia del ADC, sin caer justo en multiplos de fs
+    double worst = INFINITY;
+    double worst_f = 0.0;
+    for(double f = TEST_FS / 2; f < oversample * TEST_FS / 2; f += 0.37 * TEST_FS) {
+        test_run(oversample, f, TEST_TONE_COUNTS, 0.0);
+        double power = 0.0;
+        for(uint32_t i = 0; i < TEST_MEASURE_LEN; i++) { power += (double) decimated[i] * decimated[i] / TEST_MEASURE_LEN; }
+        // La entrada tiene TEST_TONE_COUNTS^2 / 2 y los 12 bits cuantizados dejan algo de ruido en la banda
+        const double rejection = 10.0 * log10(TEST_TONE_COUNTS * TEST_TONE_COUNTS / 2 / power);
+        if(rejection < worst) {
+            worst = rejection;
+            worst_f = f;
+        }
+    }
+    if(golden_expect(worst >= TEST_MIN_REJECTION_DB, name, "un tono fuera de la banda no bajo lo suficiente")) {
+        printf("ok %s (peor %.1f dB en %.0f Hz)\n", name, worst, worst_f);
+    }
+    else { fprintf(stderr, "%s: %.1f dB en %.0f Hz, minimo %.1f dB\n", name, worst, worst_f, TEST_MIN_REJECTION_DB); }
+}
+
+/**
+ * @brief Ruido de un seno de la banda diezmado contra una conversion por muestra
+ * @param oversample conversiones por muestra
+ * @param name nombre del caso
+*/
+static void test_snr(uint32_t oversample, const char *name) {
+    test_run(oversample, TEST_SIGNAL_HZ, TEST_SIGNAL_COUNTS, TEST_NOISE_COUNTS);
+    const double gain = 10.0 * log10(test_noise_power(plain, TEST_SIGNAL_HZ, TEST_MEASURE_LEN) / test_noise_power(decimated, TEST_SIGNAL_HZ, TEST_MEASURE_LEN));
+    const double ideal = 10.0 * log10(oversample / (2.0 * SAMPLING_DECIM_CUTOFF));
+    if(golden_expect(gain >= ideal - TEST_SNR_MARGIN_DB, name, "el diezmado no bajo el ruido")) {
+        printf("ok %s (%.1f dB mas de SNR, %.1f bits, ideal %.1f dB)\n", name, gain, gain / 6.02, ideal);
+    }
+    else { fprintf(stderr, "%s: %.1f dB, ideal %.1f dB\n", name, gain, ideal); }
+}
+
+/**
+ * @brief Convierte un seno con el ADC simulado y lo diezma como la interrupcion del DMA
+ * @param oversample conversiones por muestra
+ * @param f frecuencia del seno
+ * @param amplitude amplitud en cuentas
+ * @param noise ruido en cuentas eficaces
+*/
+static void test_run(uint32_t oversample, double f, double amplitude, double noise) {
+    const uint32_t taps = SAMPLING_DECIM_TAPS_PER_PHASE * oversample;
+    const uint32_t len = SAMPLING_BLOCK_LEN * oversample;
+    const double adc_fs = TEST_FS * oversample;
+    dsp_lowpass_q15(coeffs, taps, SAMPLING_DECIM_CUTOFF * TEST_FS, adc_fs);
+    arm_fir_decimate_init_q15(&decimator, taps, oversample, coeffs, state, len);
+    uint64_t n = 0;
+    for(uint32_t out = 0; out < TEST_SETTLE_LEN + TEST_MEASURE_LEN; out += SAMPLING_BLOCK_LEN) {
+        for(uint32_t i = 0; i < len; i++, n++) {
+            const double value = 2048.0 + amplitude * sin(2 * PI * f * n / adc_fs) + noise * test_gaussian();
+            counts[i] = (uint16_t) fmin(fmax(floor(value + 0.5), 0.0), 4095.0);
+        }
+        dsp_counts_to_q15(counts, input, len);
+        q15_t block[SAMPLING_BLOCK_LEN];
+        arm_fir_decimate_fast_q15(&decimator, input, block, len);
+        if(out < TEST_SETTLE_LEN) { continue; }
+        // Salida en cuentas y la primera conversion de cada muestra, sin diezmar
+        for(uint32_t i = 0; i < SAMPLING_BLOCK_LEN; i++) {
+            decimated[out - TEST_SETTLE_LEN + i] = block[i] / 16.0f;
+            plain[out - TEST_SETTLE_LEN + i] = input[i * oversample] / 16.0f;
+        }
+    }
+}
+
+/**
+ * @brief Potencia de lo que queda despues de restar el seno y la continua que mejor ajustan
+ * @param src puntero a muestras
+ * @param f frecuencia del seno
+ * @param len cantidad de muestras
+ * @return potencia media del residuo
+*/
+static double test_noise_power(const float32_t *src, double f, uint32_t len) {
+    // Minimos cuadrados con seno, coseno y continua (ecuaciones normales de 3x3)
+    double a[3][4] = { { 0 } };
+    for(uint32_t i = 0; i < len; i++) {
+        const double basis[3] = { sin(2 * PI * f * i / TEST_FS), cos(2 * PI * f * i / TEST_FS), 1.0 };
+        for(uint32_t r = 0; r < 3; r++) {
+            for(uint32_t c = 0; c < 3; c++) { a[r][c] += basis[r] * basis[c]; }
+            a[r][3] += basis[r] * src[i];
+        }
+    }
+    for(uint32_t p = 0; p < 3; p++) {
+        for(uint32_t r = 0; r < 3; r++) {
+            if(r == p) { continue; }
+            const double k = a[r][p] / a[p][p];
+            for(uint32_t c = p; c < 4; c++) { a[r][c] -= k * a[p][c]; }
+        }
+    }
+    double power = 0.0;
+    for(uint32_t i = 0; i < len; i++) {
+        const double fit = a[0][3] / a[0][0] * sin(2 * PI * f * i / TEST_FS) + a[1][3] / a[1][1] * cos(2 * PI * f * i / TEST_FS) + a[2][3] / a[2][2];
+        power += (src[i] - fit) * (src[i] - fit) / len;
+    }
+    return power;
+}
+
+/**
+ * @brief Ruido gaussiano de varianza 1 (Box-Muller sobre un generador congruencial)
+ * @return muestra de ruido
+*/
+static double test_gaussian(void) {
+    seed = seed * 1664525u + 1013904223u;
+    const double u1 = ((seed >> 8) + 1.0) / 16777217.0;
+    seed = seed * 1664525u + 1013904223u;
+    const double u2 = (seed >> 8) / 16777216.0;
+    return sqrt(-2.0 * log(u1)) * cos(2 * PI * u2);
+}
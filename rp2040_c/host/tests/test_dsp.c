@@ -0,0 +1,157 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "dsp.h"
+#include "fir.h"
+#include "host_ecg.h"
+#include "test_golden.h"
+
+// Salidas de dsp.c y fir.c sobre entradas fijas contra sus referencias
+//
+// Las entradas se generan aca mismo (suma de senos para la RFFT y el ECG
+// sintetico de host_ecg.c centrado para los filtros) y los filtros se corren
+// de a bloques de 16 muestras como en el firmware.
+
+// Frecuencia de muestreo de las entradas
+#define TEST_FS             1000.0f
+// Muestras de la RFFT y de los filtros
+#define TEST_RFFT_LEN       1024
+#define TEST_FILTER_LEN     2048
+// Muestras por llamada a los filtros
+#define TEST_BLOCK_LEN      16
+// Media escala del ADC (centro del ECG sintetico) y volts que representa 1.0 en q31
+#define TEST_MID_SCALE      1.65f
+#define TEST_FULL_SCALE     1.65f
+// Coeficientes del FIR
+#define TEST_FIR_TAPS       257
+// Frecuencia de muestreo, segundos de arranque y segundos medidos (un numero entero de periodos) del corte del pasaaltos
+#define TEST_CORNER_FS      10000.0f
+#define TEST_CORNER_SETTLE_S    6
+#define TEST_CORNER_MEASURE_S   4
+// Ganancia en el corte (-3 dB) y diferencia admitida en float32 y en q31
+#define TEST_CORNER_DB          (-3.0103)
+#define TEST_CORNER_TOLERANCE   0.15
+#define TEST_CORNER_TOLERANCE_Q31   0.02
+
+// Entradas y salidas
+static float32_t input[TEST_FILTER_LEN];
+static float32_t output[TEST_FILTER_LEN];
+static float32_t spectrum[TEST_RFFT_LEN] __ALIGNED(8);
+static q31_t fixed[TEST_FILTER_LEN];
+static float32_t fir_coeffs[TEST_FIR_TAPS];
+static fir_ols_t fir;
+
+// Prototipos privados
+static void test_rfft(void);
+static void test_iir(void);
+static void test_iir_q31(void);
+static void test_iir_corner(bool q31, const char *name);
+static void test_fir(void);
+static void test_ecg_input(void);
+
+/**
+ * @brief Programa principal
+ * @return 0 si pasaron todos los casos
+*/
+int main(void) {
+    dsp_init();
+    test_rfft();
+    test_iir();
+    test_iir_q31();
+    test_iir_corner(false, "dsp_iir_corner");
+    test_iir_corner(true, "dsp_iir_corner_q31");
+    test_fir();
+    return golden_result();
+}
+
+/**
+ * @brief RFFT y su normalizacion sobre una suma de senos con continua
+*/
+static void test_rfft(void) {
+    for(uint32_t i = 0; i < TEST_RFFT_LEN; i++) {
+        const double t = i / (double) TEST_FS;
+        input[i] = 0.05 + 0.3 * sin(2 * PI * 10.0 * t) + 0.1 * cos(2 * PI * 50.0 * t) + 0.02 * sin(2 * PI * 123.4 * t);
+    }
+    memcpy(output, input, TEST_RFFT_LEN * sizeof(float32_t));
+    dsp_rfft(input, spectrum, TEST_RFFT_LEN);
+    golden_expect(memcmp(output, input, TEST_RFFT_LEN * sizeof(float32_t)) == 0, "dsp_rfft", "modifico el origen");
+    golden_check_f32("dsp_rfft", spectrum, TEST_RFFT_LEN, 1e-3f);
+    dsp_rfft_normalize(spectrum, output, TEST_RFFT_LEN);
+    golden_check_f32("dsp_rfft_normalize", output, TEST_RFFT_LEN / 2, 1e-5f);
+}
+
+/**
+ * @brief Cadena IIR en float32 (pasaaltos de 0.5 Hz, pasabajos de 40 Hz y notch de 50 Hz)
+*/
+static void test_iir(void) {
+    test_ecg_input();
+    dsp_iir_init(0.5f, 40.0f, 50.0f, TEST_FS);
+    for(uint32_t i = 0; i < TEST_FILTER_LEN; i += TEST_BLOCK_LEN) { dsp_iir(&input[i], &output[i], TEST_BLOCK_LEN); }
+    golden_check_f32("dsp_iir", output, TEST_FILTER_LEN, 1e-5f);
+}
+
+/**
+ * @brief La misma cadena IIR en q31 (la salida se compara en volts)
+*/
+static void test_iir_q31(void) {
+    test_ecg_input();
+    dsp_iir_init(0.5f, 40.0f, 50.0f, TEST_FS);
+    dsp_volts_to_q31(input, fixed, TEST_FULL_SCALE, TEST_FILTER_LEN);
+    for(uint32_t i = 0; i < TEST_FILTER_LEN; i += TEST_BLOCK_LEN) { dsp_iir_q31(&fixed[i], &fixed[i], TEST_BLOCK_LEN); }
+    dsp_q31_to_volts(fixed, output, TEST_FULL_SCALE, TEST_FILTER_LEN);
+    golden_check_f32("dsp_iir_q31", output, TEST_FILTER_LEN, 1e-5f);
+}
+
+/**
+ * @brief Ganancia de la cadena IIR en el corte del pasaaltos a 10 kHz (cos(w0) casi 1.0 en float32)
+ * @param q31 true para la cadena q31, false para la float32
+ * @param name nombre del caso
+*/
+static void test_iir_corner(bool q31, const char *name) {
+    // En float32 a esta frecuencia pesa mas el redondeo de los estados de la DF2T que el de
+    // los coeficientes, por eso la tolerancia es mas ancha que en q31
+    const double f = 0.5;
+    dsp_iir_init(f, 40.0f, 0.0f, TEST_CORNER_FS);
+    const uint32_t settle = TEST_CORNER_SETTLE_S * TEST_CORNER_FS;
+    const uint32_t total = (TEST_CORNER_SETTLE_S + TEST_CORNER_MEASURE_S) * TEST_CORNER_FS;
+    double power_in = 0.0;
+    double power_out = 0.0;
+    for(uint32_t n = 0; n < total; n += TEST_BLOCK_LEN) {
+        for(uint32_t i = 0; i < TEST_BLOCK_LEN; i++) { input[i] = 0.5 * sin(2 * PI * f * (n + i) / TEST_CORNER_FS); }
+        if(q31) {
+            dsp_volts_to_q31(input, fixed, TEST_FULL_SCALE, TEST_BLOCK_LEN);
+            dsp_iir_q31(fixed, fixed, TEST_BLOCK_LEN);
+            dsp_q31_to_volts(fixed, output, TEST_FULL_SCALE, TEST_BLOCK_LEN);
+        }
+        else { dsp_iir(input, output, TEST_BLOCK_LEN); }
+        if(n < settle) { continue; }
+        for(uint32_t i = 0; i < TEST_BLOCK_LEN; i++) {
+            power_in += (double) input[i] * input[i];
+            power_out += (double) output[i] * output[i];
+        }
+    }
+    const double gain = 10.0 * log10(power_out / power_in);
+    const double tolerance = q31? TEST_CORNER_TOLERANCE_Q31 : TEST_CORNER_TOLERANCE;
+    if(golden_expect(fabs(gain - TEST_CORNER_DB) <= tolerance, name, "la ganancia en el corte no es -3 dB")) { printf("ok %s (%.3f dB)\n", name, gain); }
+    else { fprintf(stderr, "%s: %.3f dB\n", name, gain); }
+}
+
+/**
+ * @brief FIR pasabanda con rechazabanda por overlap-save
+*/
+static void test_fir(void) {
+    test_ecg_input();
+    fir_design_band(fir_coeffs, TEST_FIR_TAPS, 0.5f, 40.0f, 50.0f, 4.0f, TEST_FS);
+    golden_check_f32("fir_design_band", fir_coeffs, TEST_FIR_TAPS, 1e-6f);
+    golden_expect(fir_ols_init(&fir, fir_coeffs, TEST_FIR_TAPS), "fir_ols", "fir_ols_init fallo");
+    for(uint32_t i = 0; i < TEST_FILTER_LEN; i += TEST_BLOCK_LEN) { fir_ols(&fir, &input[i], &output[i], TEST_BLOCK_LEN); }
+    golden_check_f32("fir_ols", output, TEST_FILTER_LEN, 1e-5f);
+}
+
+/**
+ * @brief Carga el ECG sintetico centrado en media escala (con la red de 50 Hz)
+*/
+static void test_ecg_input(void) {
+    for(uint32_t i = 0; i < TEST_FILTER_LEN; i++) { input[i] = host_ecg_synthetic(i / (double) TEST_FS) - TEST_MID_SCALE; }
+}
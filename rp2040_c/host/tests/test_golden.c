@@ -0,0 +1,173 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_golden.h"
+
+// Largo maximo de la ruta de una referencia
+#define GOLDEN_PATH_LEN     512
+
+// Casos que fallaron
+static uint32_t failures = 0;
+
+// Prototipos privados
+static FILE *golden_open(const char *name, const char *mode);
+static bool golden_updating(void);
+
+/**
+ * @brief Compara valores float con su referencia
+ * @param name nombre del caso (archivo en GOLDEN_DIR)
+ * @param values puntero a valores
+ * @param len cantidad de valores
+ * @param tolerance diferencia absoluta admitida
+ * @return devuelve true si coinciden (o si se actualizo la referencia)
+*/
+bool golden_check_f32(const char *name, const float *values, uint32_t len, float tolerance) {
+    if(golden_updating()) {
+        FILE *f = golden_open(name, "w");
+        if(!f) { return golden_expect(false, name, "no se pudo escribir la referencia"); }
+        for(uint32_t i = 0; i < len; i++) { fprintf(f, "%.9g\n", values[i]); }
+        fclose(f);
+        return true;
+    }
+    FILE *f = golden_open(name, "r");
+    if(!f) { return golden_expect(false, name, "falta la referencia"); }
+    // Leo y comparo de a un valor, me quedo con la peor diferencia
+    uint32_t count = 0;
+    uint32_t worst_index = 0;
+    double worst = 0.0;
+    double expected;
+    while(fscanf(f, "%lf", &expected) == 1) {
+        if(count < len) {
+            const double diff = fabs(values[count] - expected);
+            // Un NaN en la salida cuenta como diferencia infinita
+            if(!(diff <= worst)) {
+                worst = isnan(diff)? INFINITY : diff;
+                worst_index = count;
+            }
+        }
+        count++;
+    }
+    fclose(f);
+    if(count != len) {
+        fprintf(stderr, "%s: la referencia tiene %u valores y la salida %u\n", name, count, len);
+        return golden_expect(false, name, "largo distinto");
+    }
+    if(worst > tolerance) {
+        fprintf(stderr, "%s: valor %u difiere en %g (tolerancia %g)\n", name, worst_index, worst, tolerance);
+        return golden_expect(false, name, "fuera de tolerancia");
+    }
+    printf("ok %s (%u valores, diferencia maxima %g)\n", name, len, worst);
+    return true;
+}
+
+/**
+ * @brief Compara bytes con su referencia (tienen que ser identicos)
+ * @param name nombre del caso (archivo en GOLDEN_DIR)
+ * @param data puntero a bytes
+ * @param len cantidad de bytes
+ * @return devuelve true si coinciden (o si se actualizo la referencia)
+*/
+bool golden_check_bytes(const char *name, const uint8_t *data, uint32_t len) {
+    if(golden_updating()) {
+        FILE *f = golden_open(name, "w");
+        if(!f) { return golden_expect(false, name, "no se pudo escribir la referencia"); }
+        for(uint32_t i = 0; i < len; i++) { fprintf(f, "%02x%c", data[i], (i % 16 == 15 || i == len - 1)? '\n' : ' '); }
+        fclose(f);
+        return true;
+    }
+    FILE *f = golden_open(name, "r");
+    if(!f) { return golden_expect(false, name, "falta la referencia"); }
+    uint32_t count = 0;
+    unsigned int expected;
+    bool same = true;
+    while(fscanf(f, "%x", &expected) == 1) {
+        if(same && (count >= len || data[count] != expected)) {
+            fprintf(stderr, "%s: el byte %u difiere\n", name, count);
+            same = false;
+        }
+        count++;
+    }
+    fclose(f);
+    if(same && count != len) { fprintf(stderr, "%s: la referencia tiene %u bytes y la salida %u\n", name, count, len); }
+    if(!same || count != len) { return golden_expect(false, name, "bytes distintos"); }
+    printf("ok %s (%u bytes)\n", name, len);
+    return true;
+}
+
+/**
+ * @brief Compara texto con su referencia (tiene que ser identico)
+ * @param name nombre del caso (archivo en GOLDEN_DIR)
+ * @param text puntero al texto
+ * @param len cantidad de caracteres
+ * @return devuelve true si coinciden (o si se actualizo la referencia)
+*/
+bool golden_check_text(const char *name, const char *text, uint32_t len) {
+    if(golden_updating()) {
+        FILE *f = golden_open(name, "w");
+        if(!f) { return golden_expect(false, name, "no se pudo escribir la referencia"); }
+        fwrite(text, 1, len, f);
+        fclose(f);
+        return true;
+    }
+    FILE *f = golden_open(name, "r");
+    if(!f) { return golden_expect(false, name, "falta la referencia"); }
+    // Recorro los dos hasta la primera diferencia
+    uint32_t count = 0;
+    int c;
+    while((c = fgetc(f)) != EOF && count < len && text[count] == c) { count++; }
+    const bool same = c == EOF && count == len;
+    fclose(f);
+    if(!same) {
+        fprintf(stderr, "%s: el caracter %u difiere\n", name, count);
+        return golden_expect(false, name, "texto distinto");
+    }
+    printf("ok %s (%u caracteres)\n", name, len);
+    return true;
+}
+
+/**
+ * @brief Registra una condicion del test
+ * @param condition resultado de la verificacion
+ * @param name nombre del caso
+ * @param message que se verifico
+ * @return la condicion
+*/
+bool golden_expect(bool condition, const char *name, const char *message) {
+    if(!condition) {
+        fprintf(stderr, "FALLA %s: %s\n", name, message);
+        failures++;
+    }
+    return condition;
+}
+
+/**
+ * @brief Resultado del programa de test
+ * @return 0 si pasaron todos los casos
+*/
+int golden_result(void) {
+    if(failures) { fprintf(stderr, "%u casos fallaron\n", failures); }
+    return failures? 1 : 0;
+}
+
+/**
+ * @brief Abre el archivo de referencia de un caso
+ * @param name nombre del caso
+ * @param mode modo de fopen
+ * @return archivo abierto o NULL
+*/
+static FILE *golden_open(const char *name, const char *mode) {
+    char path[GOLDEN_PATH_LEN];
+    snprintf(path, sizeof(path), "%s/%s.txt", GOLDEN_DIR, name);
+    return fopen(path, mode);
+}
+
+/**
+ * @brief Veo si hay que reescribir las referencias
+ * @return devuelve true con GOLDEN_UPDATE=1 en el entorno
+*/
+static bool golden_updating(void) {
+    const char *update = getenv("GOLDEN_UPDATE");
+    return update && strcmp(update, "1") == 0;
+}
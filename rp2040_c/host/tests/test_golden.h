@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Comparacion contra salidas de referencia para los tests de la compilacion en PC
+//
+// Cada referencia es un archivo de texto en GOLDEN_DIR con el nombre del
+// caso: un valor por linea para los float, los bytes en hexadecimal (16 por
+// linea) para las tramas y el texto tal cual. Con GOLDEN_UPDATE=1 en el
+// entorno se reescriben con la salida actual en lugar de compararse (despues
+// se revisa el diff antes de subirlas).
+
+// Prototipos de funciones
+bool golden_check_f32(const char *name, const float *values, uint32_t len, float tolerance);
+bool golden_check_bytes(const char *name, const uint8_t *data, uint32_t len);
+bool golden_check_text(const char *name, const char *text, uint32_t len);
+bool golden_expect(bool condition, const char *name, const char *message);
+int golden_result(void);
@@ -0,0 +1,186 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "app_tasks.h"
+#include "test_golden.h"
+
+// Variabilidad sobre series de RR sinteticas con valores conocidos
+//
+// Los latidos se pasan a hrv_add_beat como muestra y fraccion a TEST_FS, como
+// los manda el detector de QRS. Tres casos:
+//   hrv_time   RR con saltos pseudoaleatorios, mas largos que la ventana: SDNN,
+//              RMSSD y pNN50 contra los calculados en double sobre los RR que
+//              entran en HRV_WINDOW_S
+//   hrv_bands  RR modulados por un seno de LF y otro de HF: la potencia de cada
+//              banda es la mitad del cuadrado de su amplitud, por sinc^4(f * RR)
+//              de la interpolacion lineal entre latidos
+//   hrv_gap    un hueco de 40 minutos sin latidos no entra en la ventana, no
+//              agrega muestras a las potencias y corta el tacograma
+
+// Frecuencia de muestreo de los latidos
+#define TEST_FS             1000.0f
+// RR medio y amplitud de los saltos de hrv_time en ms
+#define TEST_RR_MS          800.0
+#define TEST_JUMP_MS        60.0
+// Latidos de hrv_time (mas que los que entran en la ventana)
+#define TEST_TIME_BEATS     500
+// Segundos de hrv_bands (la ventana entera despues del arranque de los pasabandas)
+#define TEST_BANDS_S        (2 * HRV_WINDOW_S)
+// Frecuencia y amplitud en ms de la modulacion de LF y de HF
+#define TEST_LF_HZ          0.1
+#define TEST_LF_MS          30.0
+#define TEST_HF_HZ          0.25
+#define TEST_HF_MS          20.0
+// Hueco de hrv_gap en segundos (en us no entra en int32_t)
+#define TEST_GAP_S          2400.0
+// Diferencias admitidas: ms en SDNN y RMSSD, puntos en pNN50 y relativa en las potencias
+#define TEST_TIME_TOLERANCE 0.01
+#define TEST_PNN50_TOLERANCE 0.5
+#define TEST_POWER_TOLERANCE 0.1
+
+// Variabilidad y RR de hrv_time
+static hrv_t hrv;
+static double rr_ms[TEST_TIME_BEATS];
+
+// Prototipos privados
+static void test_time(void);
+static void test_bands(void);
+static void test_gap(void);
+static void test_beat(double t);
+static double test_sinc(double x);
+static bool test_close(double value, double expected, double tolerance, const char *name, const char *message);
+
+/**
+ * @brief Programa principal
+ * @return 0 si pasaron todos los casos
+*/
+int main(void) {
+    test_time();
+    test_bands();
+    test_gap();
+    return golden_result();
+}
+
+/**
+ * @brief Dominio del tiempo contra el calculo directo sobre los RR de la ventana
+*/
+static void test_time(void) {
+    hrv_init(&hrv, TEST_FS);
+    // Saltos de hasta TEST_JUMP_MS con un generador congruencial (siempre la misma serie)
+    uint32_t seed = 12345;
+    double t = 1.0;
+    test_beat(t);
+    for(uint32_t i = 0; i < TEST_TIME_BEATS; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        rr_ms[i] = TEST_RR_MS + TEST_JUMP_MS * ((seed >> 8) / 8388608.0 - 1.0);
+        t += rr_ms[i] / 1e3;
+        test_beat(t);
+    }
+    // Los mas nuevos que entran en la ventana
+    uint32_t first = TEST_TIME_BEATS;
+    double span = 0.0;
+    while(first > 0 && span + rr_ms[first - 1] <= HRV_WINDOW_S * 1e3) { span += rr_ms[--first]; }
+    const uint32_t n = TEST_TIME_BEATS - first;
+    double mean = 0.0;
+    for(uint32_t i = first; i < TEST_TIME_BEATS; i++) { mean += rr_ms[i] / n; }
+    // Cada intervalo guarda su diferencia con el anterior aunque el anterior ya haya salido
+    double variance = 0.0;
+    double diff2 = 0.0;
+    uint32_t diffs = 0;
+    uint32_t nn50 = 0;
+    for(uint32_t i = first; i < TEST_TIME_BEATS; i++) {
+        variance += (rr_ms[i] - mean) * (rr_ms[i] - mean) / (n - 1);
+        if(i == 0) { continue; }
+        const double diff = rr_ms[i] - rr_ms[i - 1];
+        diff2 += diff * diff;
+        diffs++;
+        if(fabs(diff) > HRV_NN50_MS) { nn50++; }
+    }
+    hrv_summary_t summary;
+    hrv_get(&hrv, &summary);
+    bool ok = golden_expect(summary.intervals == n, "hrv_time", "cantidad de intervalos distinta");
+    ok = test_close(summary.sdnn_ms, sqrt(variance), TEST_TIME_TOLERANCE, "hrv_time", "SDNN distinto") && ok;
+    ok = test_close(summary.rmssd_ms, sqrt(diff2 / diffs), TEST_TIME_TOLERANCE, "hrv_time", "RMSSD distinto") && ok;
+    ok = test_close(summary.pnn50, 100.0 * nn50 / diffs, TEST_PNN50_TOLERANCE, "hrv_time", "pNN50 distinto") && ok;
+    if(ok) { printf("ok hrv_time (%u intervalos, SDNN %.2f ms, RMSSD %.2f ms, pNN50 %.1f %%)\n", n, summary.sdnn_ms, summary.rmssd_ms, summary.pnn50); }
+}
+
+/**
+ * @brief Potencia de LF y HF con una modulacion conocida en cada banda
+*/
+static void test_bands(void) {
+    hrv_init(&hrv, TEST_FS);
+    double t = 1.0;
+    test_beat(t);
+    while(t < TEST_BANDS_S) {
+        t += (TEST_RR_MS + TEST_LF_MS * sin(2 * PI * TEST_LF_HZ * t) + TEST_HF_MS * sin(2 * PI * TEST_HF_HZ * t)) / 1e3;
+        test_beat(t);
+    }
+    hrv_summary_t summary;
+    hrv_get(&hrv, &summary);
+    const double lf = TEST_LF_MS * TEST_LF_MS / 2 * pow(test_sinc(TEST_LF_HZ * TEST_RR_MS / 1e3), 4);
+    const double hf = TEST_HF_MS * TEST_HF_MS / 2 * pow(test_sinc(TEST_HF_HZ * TEST_RR_MS / 1e3), 4);
+    bool ok = test_close(summary.lf_ms2, lf, TEST_POWER_TOLERANCE * lf, "hrv_bands", "potencia de LF distinta");
+    ok = test_close(summary.hf_ms2, hf, TEST_POWER_TOLERANCE * hf, "hrv_bands", "potencia de HF distinta") && ok;
+    ok = test_close(summary.lf_hf, lf / hf, 2 * TEST_POWER_TOLERANCE * lf / hf, "hrv_bands", "LF/HF distinto") && ok;
+    if(ok) { printf("ok hrv_bands (LF %.1f ms2, HF %.1f ms2, LF/HF %.2f)\n", summary.lf_ms2, summary.hf_ms2, summary.lf_hf); }
+}
+
+/**
+ * @brief Un hueco largo sin latidos no entra en la ventana ni en las potencias
+*/
+static void test_gap(void) {
+    hrv_init(&hrv, TEST_FS);
+    double t = 1.0;
+    for(uint32_t i = 0; i <= 100; i++, t += TEST_RR_MS / 1e3) { test_beat(t); }
+    hrv_summary_t before;
+    hrv_get(&hrv, &before);
+    const uint32_t power_count = hrv.power_count;
+    test_beat(t + TEST_GAP_S);
+    hrv_summary_t after;
+    hrv_get(&hrv, &after);
+    bool ok = golden_expect(after.intervals == before.intervals, "hrv_gap", "el hueco entro en la ventana");
+    ok = golden_expect(hrv.power_count == power_count, "hrv_gap", "el hueco se remuestreo") && ok;
+    ok = golden_expect(hrv.last_rr_us == 0 && hrv.baseline_us == 0, "hrv_gap", "el tacograma no se corto") && ok;
+    // Despues del hueco la ventana sigue con latidos normales
+    t += TEST_GAP_S;
+    for(uint32_t i = 0; i < 10; i++) { test_beat(t += TEST_RR_MS / 1e3); }
+    hrv_get(&hrv, &after);
+    ok = golden_expect(after.intervals == before.intervals + 10, "hrv_gap", "no entraron los latidos siguientes") && ok;
+    ok = golden_expect(isfinite(after.lf_ms2) && isfinite(after.hf_ms2), "hrv_gap", "potencias invalidas") && ok;
+    if(ok) { printf("ok hrv_gap (%u intervalos, %u muestras del tacograma)\n", (uint32_t) after.intervals, hrv.power_count); }
+}
+
+/**
+ * @brief Agrega un latido como lo manda el detector (muestra y fraccion entre -0.5 y 0.5)
+ * @param t instante del pico R en segundos
+*/
+static void test_beat(double t) {
+    const double position = t * TEST_FS;
+    const double sample = floor(position + 0.5);
+    hrv_add_beat(&hrv, (uint32_t) sample, (float32_t) (position - sample));
+}
+
+/**
+ * @brief Seno cardinal normalizado
+ * @param x argumento
+ * @return sin(pi * x) / (pi * x)
+*/
+static double test_sinc(double x) {
+    return sin(PI * x) / (PI * x);
+}
+
+/**
+ * @brief Compara un valor con el esperado
+ * @param value valor calculado
+ * @param expected valor esperado
+ * @param tolerance diferencia admitida
+ * @param name nombre del caso
+ * @param message mensaje si no coincide
+ * @return true si coincide
+*/
+static bool test_close(double value, double expected, double tolerance, const char *name, const char *message) {
+    if(golden_expect(fabs(value - expected) <= tolerance, name, message)) { return true; }
+    fprintf(stderr, "%s: %.4f, esperado %.4f\n", name, value, expected);
+    return false;
+}
@@ -0,0 +1,147 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "app_tasks.h"
+#include "test_golden.h"
+
+// Atenuacion del cancelador de la red con la red corrida de su frecuencia
+//
+// La entrada es solo interferencia: f0 mas su segunda y tercera armonica, con
+// f0 corrida hasta TEST_DRIFT_HZ de la nominal (la referencia del cancelador
+// queda en la nominal y el LMS tiene que seguir la fase que rota). Pasa de a
+// bloques de 16 muestras por mains_cancel y por mains_cancel_q31, y despues de
+// TEST_SETTLE_S se compara el valor eficaz de la salida con el de la entrada.
+// Por encima de MAINS_TAPS_MAX * f0 el cancelador tiene que dejar la señal sin
+// tocar y el notch de la cadena IIR (lo que usa la aplicacion en ese caso)
+// tiene que bajar la fundamental.
+
+// Frecuencia de muestreo del cancelador y la del caso sin cancelador
+#define TEST_FS             1000.0f
+#define TEST_FS_NOTCH       (2 * MAINS_TAPS_MAX * 50.0f)
+// Segundos de convergencia y segundos medidos
+#define TEST_SETTLE_S       3
+#define TEST_MEASURE_S      2
+// Corrimiento de la red respecto de la nominal en Hz
+#define TEST_DRIFT_HZ       0.2
+// Amplitud de la fundamental y de las armonicas en volts
+#define TEST_HUM_V          0.2
+#define TEST_HARMONIC2_V    0.05
+#define TEST_HARMONIC3_V    0.02
+// Atenuacion minima en dB con la red en la nominal, corrida y con el notch
+#define TEST_MIN_DB         40.0
+#define TEST_MIN_DRIFT_DB   20.0
+#define TEST_MIN_NOTCH_DB   20.0
+// Muestras por llamada, como un bloque del firmware
+#define TEST_BLOCK_LEN      16
+
+// Cancelador y bloques de trabajo
+static mains_t mains;
+static float32_t volts[TEST_BLOCK_LEN];
+static float32_t output[TEST_BLOCK_LEN];
+static q31_t fixed[TEST_BLOCK_LEN];
+static q31_t fixed_in[TEST_BLOCK_LEN];
+
+// Prototipos privados
+static void test_cancel(float32_t f0, double drift, bool q31, const char *name);
+static void test_notch(float32_t f0, const char *name);
+static double test_hum(double f, double t);
+
+/**
+ * @brief Programa principal
+ * @return 0 si pasaron todos los casos
+*/
+int main(void) {
+    dsp_init();
+    static const float32_t mains_f0[] = { 50.0f, 60.0f };
+    static const double drifts[] = { 0.0, -TEST_DRIFT_HZ, TEST_DRIFT_HZ };
+    for(uint32_t f = 0; f < sizeof(mains_f0) / sizeof(mains_f0[0]); f++) {
+        for(uint32_t d = 0; d < sizeof(drifts) / sizeof(drifts[0]); d++) {
+            char name[32];
+            snprintf(name, sizeof(name), "mains_%.0f%+.1f", mains_f0[f], drifts[d]);
+            test_cancel(mains_f0[f], drifts[d], false, name);
+            snprintf(name, sizeof(name), "mains_q31_%.0f%+.1f", mains_f0[f], drifts[d]);
+            test_cancel(mains_f0[f], drifts[d], true, name);
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "mains_notch_%.0f", mains_f0[f]);
+        test_notch(mains_f0[f], name);
+    }
+    return golden_result();
+}
+
+/**
+ * @brief Pasa la interferencia por el cancelador y verifica la atenuacion
+ * @param f0 frecuencia nominal de la red
+ * @param drift corrimiento de la red en Hz
+ * @param q31 true para mains_cancel_q31, false para mains_cancel
+ * @param name nombre del caso
+*/
+static void test_cancel(float32_t f0, double drift, bool q31, const char *name) {
+    if(!golden_expect(mains_init(&mains, f0, TEST_FS), name, "mains_init rechazo la frecuencia de muestreo")) { return; }
+    const uint32_t settle = TEST_SETTLE_S * TEST_FS;
+    const uint32_t total = (TEST_SETTLE_S + TEST_MEASURE_S) * TEST_FS;
+    double power_in = 0.0;
+    double power_out = 0.0;
+    for(uint32_t n = 0; n < total; n += TEST_BLOCK_LEN) {
+        for(uint32_t i = 0; i < TEST_BLOCK_LEN; i++) { volts[i] = test_hum(f0 + drift, (n + i) / (double) TEST_FS); }
+        if(q31) {
+            dsp_volts_to_q31(volts, fixed, DSP_FIXED_FULL_SCALE, TEST_BLOCK_LEN);
+            memcpy(fixed_in, fixed, sizeof(fixed));
+            mains_cancel_q31(&mains, fixed, fixed, TEST_BLOCK_LEN);
+            dsp_q31_to_volts(fixed_in, volts, DSP_FIXED_FULL_SCALE, TEST_BLOCK_LEN);
+            dsp_q31_to_volts(fixed, output, DSP_FIXED_FULL_SCALE, TEST_BLOCK_LEN);
+        }
+        else { mains_cancel(&mains, volts, output, TEST_BLOCK_LEN); }
+        if(n < settle) { continue; }
+        for(uint32_t i = 0; i < TEST_BLOCK_LEN; i++) {
+            power_in += (double) volts[i] * volts[i];
+            power_out += (double) output[i] * output[i];
+        }
+    }
+    const double attenuation = 10.0 * log10(power_in / power_out);
+    const double minimum = (drift == 0.0)? TEST_MIN_DB : TEST_MIN_DRIFT_DB;
+    if(golden_expect(attenuation >= minimum, name, "la interferencia no bajo lo suficiente")) { printf("ok %s (%.1f dB)\n", name, attenuation); }
+    else { fprintf(stderr, "%s: %.1f dB, minimo %.1f dB\n", name, attenuation, minimum); }
+}
+
+/**
+ * @brief Sin lugar para una onda de f0 el cancelador deja pasar la señal y baja el notch
+ * @param f0 frecuencia nominal de la red
+ * @param name nombre del caso
+*/
+static void test_notch(float32_t f0, const char *name) {
+    bool ok = golden_expect(!mains_init(&mains, f0, TEST_FS_NOTCH), name, "mains_init acepto una onda de mas de MAINS_TAPS_MAX muestras");
+    dsp_iir_init(BP_F1, BP_F2, f0, TEST_FS_NOTCH);
+    const uint32_t settle = TEST_SETTLE_S * TEST_FS_NOTCH;
+    const uint32_t total = (TEST_SETTLE_S + TEST_MEASURE_S) * TEST_FS_NOTCH;
+    double power_in = 0.0;
+    double power_out = 0.0;
+    bool untouched = true;
+    for(uint32_t n = 0; n < total; n += TEST_BLOCK_LEN) {
+        for(uint32_t i = 0; i < TEST_BLOCK_LEN; i++) { volts[i] = TEST_HUM_V * sin(2 * PI * f0 * (n + i) / TEST_FS_NOTCH); }
+        mains_cancel(&mains, volts, output, TEST_BLOCK_LEN);
+        if(memcmp(volts, output, sizeof(output)) != 0) { untouched = false; }
+        dsp_iir(output, output, TEST_BLOCK_LEN);
+        if(n < settle) { continue; }
+        for(uint32_t i = 0; i < TEST_BLOCK_LEN; i++) {
+            power_in += (double) volts[i] * volts[i];
+            power_out += (double) output[i] * output[i];
+        }
+    }
+    const double attenuation = 10.0 * log10(power_in / power_out);
+    ok = golden_expect(untouched, name, "el cancelador modifico la señal") && ok;
+    ok = golden_expect(attenuation >= TEST_MIN_NOTCH_DB, name, "el notch no bajo la fundamental") && ok;
+    if(ok) { printf("ok %s (%.1f dB)\n", name, attenuation); }
+}
+
+/**
+ * @brief Interferencia de la red: fundamental y dos armonicas
+ * @param f frecuencia de la fundamental
+ * @param t tiempo en segundos
+ * @return valor en volts
+*/
+static double test_hum(double f, double t) {
+    const double w = 2 * PI * f * t;
+    return TEST_HUM_V * sin(w + 0.3) + TEST_HARMONIC2_V * sin(2 * w + 1.1) + TEST_HARMONIC3_V * sin(3 * w + 2.0);
+}
@@ -0,0 +1,128 @@
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "app_tasks.h"
+#include "host_pico.h"
+#include "test_golden.h"
+
+// Bytes que manda el firmware por USB contra sus referencias
+//
+// Las tramas de protocol_send van a un archivo temporal con
+// host_pico_set_output y las lineas de JSON de send_data (que usa printf) se
+// capturan redirigiendo stdout.
+
+// Bytes capturados como mucho por caso
+#define TEST_CAPTURE_LEN    8192
+// Valores del arreglo largo de send_data (se manda por varios tramos)
+#define TEST_LONG_LEN       300
+
+// Salida capturada
+static uint8_t capture[TEST_CAPTURE_LEN];
+
+// Prototipos privados
+static void test_protocol_send(void);
+static void test_protocol_receive(void);
+static void test_send_data(void);
+static uint32_t test_read(FILE *f);
+
+/**
+ * @brief Programa principal
+ * @return 0 si pasaron todos los casos
+*/
+int main(void) {
+    test_protocol_send();
+    test_protocol_receive();
+    test_send_data();
+    return golden_result();
+}
+
+/**
+ * @brief Tramas de cada tipo de dato, una vacia y la configuracion de la sesion
+*/
+static void test_protocol_send(void) {
+    FILE *f = tmpfile();
+    host_pico_set_output(f);
+    const float32_t filtered[] = { 0.0f, -0.009545f, 1.25f, -1.65f };
+    const uint32_t counters[] = { 16000, 0, 1000 };
+    const protocol_meta_t meta = {
+        .fs = 1000.0f,
+        .fft_len = 1024,
+        .volts_per_count = 3.3f / 4095,
+        .notch_f0 = 50.0f,
+        .bp_f1 = 0.5f,
+        .bp_f2 = 40.0f,
+        .leads = 1,
+    };
+    protocol_send(STREAM_FILTERED, PROTOCOL_F32, 0x12345678, filtered, sizeof(filtered) / sizeof(float32_t));
+    protocol_send(STREAM_STATS, PROTOCOL_U32, 62, counters, sizeof(counters) / sizeof(uint32_t));
+    protocol_send(STREAM_META, PROTOCOL_U8, 0, &meta, sizeof(meta));
+    protocol_send(STREAM_BEATS, PROTOCOL_U8, 7, NULL, 0);
+    host_pico_set_output(NULL);
+    golden_check_bytes("protocol_send", capture, test_read(f));
+}
+
+/**
+ * @brief Un comando armado con protocol_send vuelve entero por protocol_receive, con ruido antes
+*/
+static void test_protocol_receive(void) {
+    FILE *f = tmpfile();
+    host_pico_set_output(f);
+    const uint8_t noise[] = { 0x00, PROTOCOL_SYNC0, 0x13, PROTOCOL_SYNC0 };
+    fwrite(noise, 1, sizeof(noise), f);
+    const protocol_config_t config = { .fs = 500.0f, .fft_len = 256 };
+    protocol_send(COMMAND_CONFIG, PROTOCOL_U8, 0, &config, sizeof(config));
+    host_pico_set_output(NULL);
+    const uint32_t len = test_read(f);
+    protocol_rx_t rx = {0};
+    uint32_t frames = 0;
+    for(uint32_t i = 0; i < len; i++) { frames += protocol_receive(&rx, capture[i]); }
+    golden_expect(frames == 1, "protocol_receive", "no llego una sola trama");
+    golden_expect(rx.command == COMMAND_CONFIG && rx.size == sizeof(config), "protocol_receive", "comando o largo distinto");
+    golden_expect(frames == 1 && memcmp(rx.payload, &config, sizeof(config)) == 0, "protocol_receive", "payload distinto");
+    // Un byte cambiado del payload no pasa el CRC
+    capture[sizeof(noise) + PROTOCOL_HEADER_LEN] ^= 0x01;
+    frames = 0;
+    for(uint32_t i = 0; i < len; i++) { frames += protocol_receive(&rx, capture[i]); }
+    golden_expect(frames == 0, "protocol_receive", "acepto una trama con el CRC mal");
+}
+
+/**
+ * @brief Lineas de JSON de send_data, con valores del largo maximo y un arreglo que no entra en el buffer
+*/
+static void test_send_data(void) {
+    const float32_t values[] = { -0.009545f, 799.999939f, 0.0f, -FLT_MAX, FLT_MAX, 1e-7f };
+    float32_t ramp[TEST_LONG_LEN];
+    for(uint32_t i = 0; i < TEST_LONG_LEN; i++) { ramp[i] = -1.65f + 3.3f * i / TEST_LONG_LEN; }
+    // Redirijo stdout a un archivo temporal mientras manda
+    FILE *f = tmpfile();
+    fflush(stdout);
+    const int saved = dup(STDOUT_FILENO);
+    dup2(fileno(f), STDOUT_FILENO);
+    send_data("values", values, sizeof(values) / sizeof(float32_t));
+    send_data("empty", values, 0);
+    send_data("ramp", ramp, TEST_LONG_LEN);
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    const uint32_t len = test_read(f);
+    golden_check_text("send_data", (const char*) capture, len);
+    // Tres lineas completas
+    uint32_t lines = 0;
+    for(uint32_t i = 0; i < len; i++) { lines += capture[i] == '\n'; }
+    golden_expect(lines == 3 && len > 0 && capture[len - 1] == '\n', "send_data", "no son tres lineas");
+}
+
+/**
+ * @brief Lee lo que se escribio en un archivo temporal y lo cierra
+ * @param f archivo temporal
+ * @return bytes leidos en capture
+*/
+static uint32_t test_read(FILE *f) {
+    fflush(f);
+    rewind(f);
+    const uint32_t len = fread(capture, 1, sizeof(capture), f);
+    fclose(f);
+    return len;
+}
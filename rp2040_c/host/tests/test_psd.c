@@ -0,0 +1,152 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "app_tasks.h"
+#include "test_golden.h"
+
+// Estimador de Welch contra un Welch de referencia en double
+//
+// La señal es un seno centrado en un bin mas ruido blanco gaussiano y entra
+// como en app_dsp_task: de a bloques, con psd_start al empezar cada ventana de
+// TEST_WINDOW_LEN muestras y psd_get al cerrarla, mientras el buffer del
+// estimador sigue de una ventana a la otra. La referencia toma la misma serie
+// entera, corta un segmento cada len / 2 muestras y suma en cada ventana los
+// que se completan dentro de ella (la primera tiene uno menos porque el
+// primer segmento espera len muestras), con la DFT directa en double. Por
+// ventana se verifica la cantidad de segmentos, el resultado bin a bin, que
+// el pico caiga en el bin del seno y que el piso de ruido quede en 2 * sigma^2
+// / fs. Dos casos: segmentos de 256 con bloques de 16 (como la aplicacion) y
+// segmentos de 32 con bloques de 64, que completan varios segmentos por
+// llamada.
+
+// Frecuencia de muestreo, ventanas y muestras por ventana
+#define TEST_FS             1000.0f
+#define TEST_WINDOWS        3
+#define TEST_WINDOW_LEN     1024
+#define TEST_LEN            (TEST_WINDOWS * TEST_WINDOW_LEN)
+// Segmento mas largo de los casos
+#define TEST_SEGMENT_MAX    256
+// Bin del seno, amplitud en volts y desvio del ruido en volts
+#define TEST_SINE_BIN       16.0
+#define TEST_SINE_V         0.5
+#define TEST_NOISE_V        0.01
+// Bins a cada lado del pico que no cuentan para el piso de ruido
+#define TEST_PEAK_WIDTH     4
+// Diferencia relativa admitida bin a bin y diferencia admitida del piso en dB
+#define TEST_TOLERANCE      1e-3
+#define TEST_FLOOR_DB       1.0
+
+// Estimador, señal y resultados
+static psd_t psd;
+static float32_t signal[TEST_LEN];
+static float32_t power[TEST_SEGMENT_MAX / 2];
+static float32_t work[2 * TEST_SEGMENT_MAX] __ALIGNED(8);
+static double reference[TEST_SEGMENT_MAX / 2];
+// Generador del ruido (siempre la misma serie)
+static uint32_t seed = 12345;
+
+// Prototipos privados
+static void test_welch(uint32_t len, uint32_t block_len, const char *name);
+static uint32_t test_reference(uint32_t len, uint32_t window);
+static double test_gaussian(void);
+
+/**
+ * @brief Programa principal
+ * @return 0 si pasaron todos los casos
+*/
+int main(void) {
+    for(uint32_t i = 0; i < TEST_LEN; i++) { signal[i] = TEST_SINE_V * sin(2 * PI * TEST_SINE_BIN * i / 256.0) + TEST_NOISE_V * test_gaussian(); }
+    test_welch(256, 16, "psd_256");
+    test_welch(32, 64, "psd_32");
+    return golden_result();
+}
+
+/**
+ * @brief Corre el estimador por ventanas y compara cada una con la referencia
+ * @param len muestras por segmento
+ * @param block_len muestras por llamada a psd_add (divide a TEST_WINDOW_LEN)
+ * @param name nombre del caso
+*/
+static void test_welch(uint32_t len, uint32_t block_len, const char *name) {
+    if(!golden_expect(psd_init(&psd, len, PSD_WINDOW_HANNING, TEST_FS), name, "psd_init rechazo el largo")) { return; }
+    const uint32_t bins = len / 2;
+    // El seno cae en el centro de un bin de los segmentos de 256 y de los mas cortos
+    const uint32_t peak_bin = TEST_SINE_BIN * len / 256 + 0.5;
+    const double floor_expected = 2.0 * TEST_NOISE_V * TEST_NOISE_V / TEST_FS;
+    bool ok = true;
+    double worst = 0.0;
+    double floor_db = 0.0;
+    for(uint32_t w = 0; w < TEST_WINDOWS; w++) {
+        psd_start(&psd, power, work);
+        for(uint32_t i = 0; i < TEST_WINDOW_LEN; i += block_len) { psd_add(&psd, &signal[w * TEST_WINDOW_LEN + i], block_len); }
+        const uint32_t segments = psd_get(&psd);
+        const uint32_t expected = test_reference(len, w);
+        ok = golden_expect(segments == expected, name, "cantidad de segmentos distinta") && ok;
+        // Bin a bin contra la referencia, relativo al pico
+        uint32_t peak = 0;
+        for(uint32_t k = 0; k < bins; k++) {
+            const double error = fabs(power[k] - reference[k]) / reference[peak_bin];
+            if(error > worst) { worst = error; }
+            if(power[k] > power[peak]) { peak = k; }
+        }
+        ok = golden_expect(peak == peak_bin, name, "el pico no cae en el bin del seno") && ok;
+        // Piso de ruido: media de los bins lejos del pico y de la continua
+        double noise = 0.0;
+        uint32_t count = 0;
+        for(uint32_t k = 2; k < bins; k++) {
+            if(k + TEST_PEAK_WIDTH >= peak_bin && k <= peak_bin + TEST_PEAK_WIDTH) { continue; }
+            noise += power[k];
+            count++;
+        }
+        floor_db = 10.0 * log10(noise / count / floor_expected);
+        ok = golden_expect(fabs(floor_db) <= TEST_FLOOR_DB, name, "el piso de ruido no es 2 * sigma^2 / fs") && ok;
+    }
+    ok = golden_expect(worst <= TEST_TOLERANCE, name, "el resultado no coincide con la referencia") && ok;
+    if(ok) { printf("ok %s (error %.1e del pico, piso %+.2f dB)\n", name, worst, floor_db); }
+    else { fprintf(stderr, "%s: error %.1e del pico, piso %+.2f dB\n", name, worst, floor_db); }
+}
+
+/**
+ * @brief Welch de referencia de una ventana en double
+ * @param len muestras por segmento
+ * @param window ventana de TEST_WINDOW_LEN muestras
+ * @return cantidad de segmentos que se completan en la ventana
+*/
+static uint32_t test_reference(uint32_t len, uint32_t window) {
+    const uint32_t hop = len / 2;
+    double energy = 0.0;
+    for(uint32_t i = 0; i < len; i++) { energy += (double) psd.window[i] * psd.window[i]; }
+    for(uint32_t k = 0; k < len / 2; k++) { reference[k] = 0.0; }
+    uint32_t segments = 0;
+    // Segmentos que empiezan cada hop y terminan (ultima muestra) dentro de la ventana
+    for(uint32_t start = 0; start + len <= TEST_LEN; start += hop) {
+        const uint32_t end = start + len - 1;
+        if(end < window * TEST_WINDOW_LEN || end >= (window + 1) * TEST_WINDOW_LEN) { continue; }
+        for(uint32_t k = 0; k < len / 2; k++) {
+            double re = 0.0;
+            double im = 0.0;
+            for(uint32_t i = 0; i < len; i++) {
+                const double x = (double) signal[start + i] * psd.window[i];
+                re += x * cos(2 * PI * k * i / len);
+                im -= x * sin(2 * PI * k * i / len);
+            }
+            reference[k] += re * re + im * im;
+        }
+        segments++;
+    }
+    // V^2 / Hz de un solo lado, sin duplicar la continua
+    for(uint32_t k = 0; k < len / 2; k++) { reference[k] *= ((k == 0)? 1.0 : 2.0) / (segments * TEST_FS * energy); }
+    return segments;
+}
+
+/**
+ * @brief Ruido gaussiano de varianza 1 (Box-Muller sobre un generador congruencial)
+ * @return muestra de ruido
+*/
+static double test_gaussian(void) {
+    seed = seed * 1664525u + 1013904223u;
+    const double u1 = ((seed >> 8) + 1.0) / 16777217.0;
+    seed = seed * 1664525u + 1013904223u;
+    const double u2 = (seed >> 8) / 16777216.0;
+    return sqrt(-2.0 * log(u1)) * cos(2 * PI * u2);
+}
@@ -0,0 +1,90 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "app_tasks.h"
+#include "host_ecg.h"
+#include "test_golden.h"
+
+// Latidos del detector de QRS sobre el ECG sintetico a varias frecuencias
+//
+// El ECG pasa por la cadena IIR como en el firmware y el detector recibe la
+// señal filtrada en q31. Por encima de QRS_FS_MAX el detector diezma, asi
+// que ademas de la cantidad de latidos se verifica que la muestra mas la
+// fraccion caiga siempre a la misma distancia del pico R del ECG sintetico
+// (la cadena IIR lo atrasa unos milisegundos) y que el RR salga en muestras
+// de fs.
+
+// Segundos de ECG (los dos primeros son de aprendizaje)
+#define TEST_SECONDS        12
+// Muestras por llamada, como un bloque del firmware
+#define TEST_BLOCK_LEN      16
+// Latidos que puede devolver una llamada
+#define TEST_BEATS_MAX      4
+// Retardo admitido del pico R y variacion admitida entre latidos en segundos
+#define TEST_PEAK_DELAY     0.010
+#define TEST_PEAK_TOLERANCE 0.001
+// Instante del pico R dentro del latido (onda R de host_ecg.c)
+#define TEST_R_PHASE        0.30
+
+// Detector y bloques de trabajo
+static qrs_t qrs;
+static float32_t volts[TEST_BLOCK_LEN];
+static float32_t filtered[TEST_BLOCK_LEN];
+static q31_t fixed[TEST_BLOCK_LEN];
+
+// Prototipos privados
+static void test_fs(float32_t fs, const char *name);
+
+/**
+ * @brief Programa principal
+ * @return 0 si pasaron todos los casos
+*/
+int main(void) {
+    dsp_init();
+    test_fs(250.0f, "qrs_250");
+    test_fs(1000.0f, "qrs_1000");
+    test_fs(5000.0f, "qrs_5000");
+    test_fs(10000.0f, "qrs_10000");
+    return golden_result();
+}
+
+/**
+ * @brief Detecta los latidos a una frecuencia y los compara con los del ECG sintetico
+ * @param fs frecuencia de muestreo
+ * @param name nombre del caso
+*/
+static void test_fs(float32_t fs, const char *name) {
+    dsp_iir_init(0.5f, 40.0f, 50.0f, fs);
+    qrs_init(&qrs, fs, DSP_FIXED_FULL_SCALE);
+    const uint32_t total = TEST_SECONDS * fs;
+    uint32_t beats = 0;
+    double first = INFINITY;
+    double last = -INFINITY;
+    bool rr_ok = true;
+    for(uint32_t n = 0; n < total; n += TEST_BLOCK_LEN) {
+        for(uint32_t i = 0; i < TEST_BLOCK_LEN; i++) { volts[i] = host_ecg_synthetic((n + i) / (double) fs) - ADC_MID_SCALE_VOLTS; }
+        dsp_iir(volts, filtered, TEST_BLOCK_LEN);
+        dsp_volts_to_q31(filtered, fixed, DSP_FIXED_FULL_SCALE, TEST_BLOCK_LEN);
+        qrs_beat_t found[TEST_BEATS_MAX];
+        const uint32_t count = qrs_process(&qrs, fixed, TEST_BLOCK_LEN, n, found, TEST_BEATS_MAX);
+        for(uint32_t i = 0; i < count; i++) {
+            // Distancia al pico R mas cercano del ECG sintetico
+            const double t = (found[i].sample + found[i].offset) / fs;
+            const double beat = floor((t - TEST_R_PHASE * HOST_ECG_BEAT_S) / HOST_ECG_BEAT_S + 0.5);
+            const double error = t - (beat + TEST_R_PHASE) * HOST_ECG_BEAT_S;
+            if(error < first) { first = error; }
+            if(error > last) { last = error; }
+            // Fuera del primero el RR es un periodo del ECG (el detector puede correrse una muestra diezmada)
+            if(found[i].rr && fabs(found[i].rr - HOST_ECG_BEAT_S * fs) > qrs.decim + 1) { rr_ok = false; }
+            if(found[i].offset < -0.5f || found[i].offset > 0.5f) { rr_ok = false; }
+            beats++;
+        }
+    }
+    // Despues del aprendizaje tienen que salir todos los latidos menos, como mucho, el ultimo
+    const uint32_t expected = (TEST_SECONDS - QRS_LEARN_MS / 1000) / HOST_ECG_BEAT_S;
+    bool ok = golden_expect(beats + 1 >= expected && beats <= expected + 1, name, "cantidad de latidos distinta");
+    ok = golden_expect(first >= 0.0 && last <= TEST_PEAK_DELAY, name, "el latido no cae en el pico R") && ok;
+    ok = golden_expect(last - first <= TEST_PEAK_TOLERANCE, name, "el latido se mueve respecto del pico R") && ok;
+    ok = golden_expect(rr_ok, name, "RR u offset fuera de rango") && ok;
+    if(ok) { printf("ok %s (%u latidos, diezmado %u, retardo de %.3f a %.3f ms)\n", name, beats, qrs.decim, first * 1e3, last * 1e3); }
+}
@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "app_tasks.h"
+#include "host_ecg.h"
+#include "test_golden.h"
+
+// SNR de las cadenas q15 y q31 contra la cadena float32 (la tabla de dsp.h)
+//
+// Las tres arrancan de las mismas cuentas de 12 bits del ECG sintetico de
+// host_ecg.c (0.6 Vpp con 0.4 Vpp de 50 Hz) a 1 kHz y hacen lo mismo que
+// app_filter_block y app_spectrum: la cadena IIR de a bloques de 16 muestras
+// (en q31 para los dos formatos fijos, en q15 la ventana filtrada se trunca
+// antes de la RFFT) y el espectro normalizado de la entrada y de la señal
+// filtrada sobre la ultima ventana de 1024 muestras, cuando ya paso el
+// transitorio del pasaaltos. Los valores se comparan contra la referencia con
+// 0.1 dB de tolerancia.
+
+// Frecuencia de muestreo y muestras filtradas (la ventana es la ultima parte)
+#define TEST_FS             1000.0f
+#define TEST_LEN            4096
+#define TEST_WINDOW_LEN     FFT_LEN
+// Muestras por llamada a la cadena IIR
+#define TEST_BLOCK_LEN      16
+// Diferencia admitida en dB
+#define TEST_TOLERANCE_DB   0.1f
+
+// Casos de la tabla
+enum { SNR_SPECTRUM, SNR_SPECTRUM_FILTERED, SNR_FILTERED, SNR_CASES };
+
+// Entradas y salidas
+static uint16_t counts[TEST_LEN];
+static float32_t volts[TEST_LEN];
+static float32_t filtered[TEST_LEN];
+static q31_t filtered_q31[TEST_LEN];
+static float32_t filtered_fixed[TEST_LEN];
+static q15_t window_q15[TEST_WINDOW_LEN];
+static q31_t window_q31[TEST_WINDOW_LEN];
+static q15_t spectrum_q15[2 * TEST_WINDOW_LEN] __ALIGNED(8);
+static q31_t spectrum_q31[2 * TEST_WINDOW_LEN] __ALIGNED(8);
+static float32_t spectrum[TEST_WINDOW_LEN] __ALIGNED(8);
+static float32_t reference[2][TEST_WINDOW_LEN / 2];
+static float32_t magnitude[TEST_WINDOW_LEN / 2];
+
+// Prototipos privados
+static void test_reference(void);
+static void test_filter_fixed(void);
+static void test_q15(float32_t *snr);
+static void test_q31(float32_t *snr);
+
+/**
+ * @brief Programa principal
+ * @return 0 si pasaron todos los casos
+*/
+int main(void) {
+    dsp_init();
+    // Cuentas cuantizadas y los mismos valores en volts centrados para float32
+    for(uint32_t i = 0; i < TEST_LEN; i++) { counts[i] = host_ecg_counts(host_ecg_synthetic(i / (double) TEST_FS)); }
+    q15_t centred[TEST_BLOCK_LEN];
+    for(uint32_t i = 0; i < TEST_LEN; i += TEST_BLOCK_LEN) {
+        dsp_counts_to_q15(&counts[i], centred, TEST_BLOCK_LEN);
+        dsp_q15_to_volts(centred, &volts[i], DSP_FIXED_FULL_SCALE, TEST_BLOCK_LEN);
+    }
+    test_reference();
+    test_filter_fixed();
+    float32_t snr[2 * SNR_CASES];
+    test_q15(&snr[0]);
+    test_q31(&snr[SNR_CASES]);
+    printf("        espectro  espectro filtrado  señal filtrada\n");
+    printf("q15: %8.1f dB %13.1f dB %12.1f dB\n", snr[0], snr[1], snr[2]);
+    printf("q31: %8.1f dB %13.1f dB %12.1f dB\n", snr[3], snr[4], snr[5]);
+    golden_check_f32("dsp_snr", snr, 2 * SNR_CASES, TEST_TOLERANCE_DB);
+    return golden_result();
+}
+
+/**
+ * @brief Cadena float32: filtra todo y guarda los espectros de la ultima ventana
+*/
+static void test_reference(void) {
+    dsp_iir_init(0.5f, 40.0f, 50.0f, TEST_FS);
+    for(uint32_t i = 0; i < TEST_LEN; i += TEST_BLOCK_LEN) { dsp_iir(&volts[i], &filtered[i], TEST_BLOCK_LEN); }
+    const uint32_t start = TEST_LEN - TEST_WINDOW_LEN;
+    dsp_rfft(&volts[start], spectrum, TEST_WINDOW_LEN);
+    dsp_rfft_normalize(spectrum, reference[0], TEST_WINDOW_LEN);
+    dsp_rfft(&filtered[start], spectrum, TEST_WINDOW_LEN);
+    dsp_rfft_normalize(spectrum, reference[1], TEST_WINDOW_LEN);
+}
+
+/**
+ * @brief Cadena IIR en q31 de los formatos fijos, con la salida tambien en volts
+*/
+static void test_filter_fixed(void) {
+    dsp_iir_init(0.5f, 40.0f, 50.0f, TEST_FS);
+    for(uint32_t i = 0; i < TEST_LEN; i += TEST_BLOCK_LEN) {
+        dsp_counts_to_q31(&counts[i], &filtered_q31[i], TEST_BLOCK_LEN);
+        dsp_iir_q31(&filtered_q31[i], &filtered_q31[i], TEST_BLOCK_LEN);
+    }
+    dsp_q31_to_volts(filtered_q31, filtered_fixed, DSP_FIXED_FULL_SCALE, TEST_LEN);
+}
+
+/**
+ * @brief Espectros en q15 contra float32
+ * @param snr puntero a destino de los SNR_CASES valores en dB
+*/
+static void test_q15(float32_t *snr) {
+    const uint32_t start = TEST_LEN - TEST_WINDOW_LEN;
+    dsp_counts_to_q15(&counts[start], window_q15, TEST_WINDOW_LEN);
+    dsp_rfft_q15(window_q15, spectrum_q15, TEST_WINDOW_LEN);
+    dsp_rfft_normalize_q15(spectrum_q15, magnitude, DSP_FIXED_FULL_SCALE, TEST_WINDOW_LEN);
+    snr[SNR_SPECTRUM] = dsp_snr_db(reference[0], magnitude, TEST_WINDOW_LEN / 2);
+    arm_q31_to_q15(&filtered_q31[start], window_q15, TEST_WINDOW_LEN);
+    dsp_rfft_q15(window_q15, spectrum_q15, TEST_WINDOW_LEN);
+    dsp_rfft_normalize_q15(spectrum_q15, magnitude, DSP_FIXED_FULL_SCALE, TEST_WINDOW_LEN);
+    snr[SNR_SPECTRUM_FILTERED] = dsp_snr_db(reference[1], magnitude, TEST_WINDOW_LEN / 2);
+    snr[SNR_FILTERED] = dsp_snr_db(&filtered[start], &filtered_fixed[start], TEST_WINDOW_LEN);
+}
+
+/**
+ * @brief Espectros en q31 contra float32
+ * @param snr puntero a destino de los SNR_CASES valores en dB
+*/
+static void test_q31(float32_t *snr) {
+    const uint32_t start = TEST_LEN - TEST_WINDOW_LEN;
+    dsp_counts_to_q31(&counts[start], window_q31, TEST_WINDOW_LEN);
+    dsp_rfft_q31(window_q31, spectrum_q31, TEST_WINDOW_LEN);
+    dsp_rfft_normalize_q31(spectrum_q31, magnitude, DSP_FIXED_FULL_SCALE, TEST_WINDOW_LEN);
+    snr[SNR_SPECTRUM] = dsp_snr_db(reference[0], magnitude, TEST_WINDOW_LEN / 2);
+    memcpy(window_q31, &filtered_q31[start], sizeof(window_q31));
+    dsp_rfft_q31(window_q31, spectrum_q31, TEST_WINDOW_LEN);
+    dsp_rfft_normalize_q31(spectrum_q31, magnitude, DSP_FIXED_FULL_SCALE, TEST_WINDOW_LEN);
+    snr[SNR_SPECTRUM_FILTERED] = dsp_snr_db(reference[1], magnitude, TEST_WINDOW_LEN / 2);
+    snr[SNR_FILTERED] = dsp_snr_db(&filtered[start], &filtered_fixed[start], TEST_WINDOW_LEN);
+}
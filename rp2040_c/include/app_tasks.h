@@ -1,17 +1,244 @@
 #include "pico/stdlib.h"
 #include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "pico/multicore.h"
+#include "pico/stdio_usb.h"
 #include "arm_math.h"
 
 #include "dsp.h"
+#include "fir.h"
+#include "hrv.h"
+#include "mains.h"
+#include "psd.h"
+#include "qrs.h"
+#include "profile.h"
+#include "protocol.h"
+#include "spsc_queue.h"
 
+// Entrada del ADC de la primera derivacion (las siguientes van en las entradas y GPIO siguientes)
 #define ECG_ADC_GPIO    26
 #define ECG_ADC_CH      0
 
-// Variables para la RFFT
-extern float32_t rfft_input[FFT_LEN];
+// Reloj del ADC (USB PLL) en Hz
+#define ADC_CLK_HZ      48000000.0f
+// Tension de referencia del ADC
+#define ADC_VREF        3.3f
+// Cuenta maxima del ADC de 12 bits
+#define ADC_MAX_COUNT   4095
+// Tension por cuenta del ADC
+#define ADC_VOLTS_PER_COUNT (ADC_VREF / ADC_MAX_COUNT)
+// Media escala del ADC en volts (el cero de la cadena de filtrado)
+#define ADC_MID_SCALE_VOLTS (2048 * ADC_VOLTS_PER_COUNT)
+// Volts que representa 1.0 en punto fijo (2048 cuentas, ver dsp.h)
+#define DSP_FIXED_FULL_SCALE (2048 * ADC_VOLTS_PER_COUNT)
+
+// Muestras por bloque de DMA (fija la latencia de la señal filtrada, 16 ms a 1 kHz)
+#define SAMPLING_BLOCK_LEN  16
+// Cantidad de buffers de muestras (dos los usa el DMA, el resto cubre las FFT de cada ventana)
+#define SAMPLING_BUFFERS    16
+// Frecuencia minima del ADC (el divisor tiene 16 bits de parte entera)
+#define SAMPLING_ADC_FS_MIN (ADC_CLK_HZ / 65536.0f)
+// Frecuencia maxima del ADC (96 ciclos por conversion)
+#define SAMPLING_ADC_FS_MAX (ADC_CLK_HZ / 96.0f)
+
+// Sobremuestreo: el ADC convierte SAMPLING_OVERSAMPLE veces por muestra, el
+// DMA junta SAMPLING_BLOCK_LEN * SAMPLING_OVERSAMPLE conversiones y la
+// interrupcion las diezma a fs con un FIR polifasico en q15
+// (arm_fir_decimate_fast_q15, solo calcula las salidas que quedan). El
+// pasabajos corta en SAMPLING_DECIM_CUTOFF * fs y con Hamming atenua mas de
+// 50 dB desde fs / 2, asi que tambien es el antialiasing. Del ruido blanco del
+// ADC pasa 2 * SAMPLING_DECIM_CUTOFF / SAMPLING_OVERSAMPLE (con 16 baja 13.6 dB,
+// unos 2.3 bits mas) y la salida en q15 tiene 4 bits por debajo de la cuenta
+// para guardarlos. Cuesta SAMPLING_DECIM_TAPS_PER_PHASE * SAMPLING_OVERSAMPLE
+// multiplicaciones de 16 bits por muestra (PROFILE_DECIMATE lo mide).
+// host/tests/test_decimate.c verifica la atenuacion y la ganancia de SNR con
+// 8 y con 32.
+#ifndef SAMPLING_OVERSAMPLE
+#define SAMPLING_OVERSAMPLE 16
+#endif
+// Coeficientes del FIR de diezmado por cada conversion de sobremuestreo (la transicion mide 3.3 * fs / este valor)
+#define SAMPLING_DECIM_TAPS_PER_PHASE   16
+#define SAMPLING_DECIM_TAPS (SAMPLING_DECIM_TAPS_PER_PHASE * SAMPLING_OVERSAMPLE)
+// Corte del FIR de diezmado relativo a fs (plano hasta 0.25 * fs)
+#define SAMPLING_DECIM_CUTOFF   0.35f
+
+#if SAMPLING_BUFFERS < 2 || SAMPLING_BUFFERS > SPSC_QUEUE_LEN
+#error "SAMPLING_BUFFERS tiene que estar entre 2 y SPSC_QUEUE_LEN"
+#endif
+#if FFT_LEN_MIN % SAMPLING_BLOCK_LEN != 0
+#error "FFT_LEN_MIN tiene que ser multiplo de SAMPLING_BLOCK_LEN"
+#endif
+// Sobremuestreo de 8 a 32: con 8 el ruido ya baja 10.6 dB y por encima de 32 cada
+// duplicacion gana medio bit a costa de duplicar las multiplicaciones del diezmado. En ese
+// rango el ADC queda entre SAMPLING_ADC_FS_MIN y SAMPLING_ADC_FS_MAX con FS_MIN a FS_MAX
+#if SAMPLING_OVERSAMPLE < 8 || SAMPLING_OVERSAMPLE > 32
+#error "SAMPLING_OVERSAMPLE tiene que estar entre 8 y 32"
+#endif
+// dsp_lowpass_q15 diseña el FIR de diezmado en la memoria de trabajo del DSP
+#if SAMPLING_DECIM_TAPS > DSP_SCRATCH_LEN
+#error "SAMPLING_DECIM_TAPS no entra en DSP_SCRATCH_LEN"
+#endif
+
+// Derivaciones del ECG (entradas 0 a 3 del ADC, GPIO26 a GPIO29). El ADC las
+// convierte por turno (round-robin) y el DMA las deja intercaladas, la
+// interrupcion las separa y diezma cada una con su estado. La primera pasa por
+// toda la cadena (espectros, PSD, QRS y variabilidad) y las demas solo por el
+// cancelador de la red y la cadena IIR (tambien con APP_FIR_FILTER) y salen en
+// STREAM_LEADS. En float32 la cadena IIR las filtra de a pares con la biquad
+// estereo (ver dsp.h). Cada derivacion se convierte 1 / (fs *
+// SAMPLING_OVERSAMPLE * APP_LEADS) despues de la anterior, bastante menos que
+// el retardo del diezmado.
+#ifndef APP_LEADS
+#define APP_LEADS           1
+#endif
+// Frecuencia de muestreo maxima con todas las derivaciones (el ADC convierte fs * SAMPLING_OVERSAMPLE * APP_LEADS por segundo)
+#define SAMPLING_FS_MAX     (SAMPLING_ADC_FS_MAX / (SAMPLING_OVERSAMPLE * APP_LEADS))
+
+// Corre el procesamiento DSP en el nucleo 1 (0 para hacer todo en el nucleo 0)
+#ifndef APP_DUAL_CORE
+#define APP_DUAL_CORE       1
+#endif
+// Cantidad de resultados en vuelo entre el DSP y el envio por USB
+#define APP_RESULT_SLOTS    2
+// Cantidad de bloques filtrados en vuelo entre el DSP y el envio por USB
+#define APP_CHUNK_SLOTS     8
+
+// Manda tramas binarias (0 para mandar lineas de JSON con send_data)
+#ifndef APP_PROTOCOL_BINARY
+#define APP_PROTOCOL_BINARY 1
+#endif
+// Buffer de linea de send_data y lo que ocupa un valor como mucho ("%f," de
+// -FLT_MAX son 39 digitos, signo, punto, 6 decimales y coma, mas el fin de cadena)
+#define SEND_DATA_BUFFER_LEN    256
+#define SEND_DATA_VALUE_LEN     49
+// Manda la señal y los espectros (0 para mandar solo latidos, variabilidad,
+// contadores y tiempos, unos pocos cientos de bytes por segundo)
+#ifndef APP_SEND_RAW
+#define APP_SEND_RAW        1
+#endif
+
+// Filtra con un FIR de fase lineal por overlap-save en lugar de la cadena IIR
+// (solo en float32, la señal filtrada sale FIR_OLS_FFT_LEN / 2 muestras mas
+// el retardo de grupo atrasada respecto de su numero de bloque)
+#ifndef APP_FIR_FILTER
+#define APP_FIR_FILTER      0
+#endif
+// Coeficientes del FIR y ancho del rechazabanda (si el notch cae en la banda de paso)
+#define APP_FIR_TAPS        FIR_OLS_TAPS_MAX
+#define APP_FIR_NOTCH_BW    4.0
+
+// Ventana de los segmentos de Welch y cuantos segmentos entran en fft_len (el
+// segmento es fft_len / APP_PSD_DIVIDER y con 50 % de solapamiento se
+// promedian 2 * APP_PSD_DIVIDER por ventana)
+#ifndef APP_PSD_WINDOW
+#define APP_PSD_WINDOW      PSD_WINDOW_HANNING
+#endif
+#define APP_PSD_DIVIDER     4
+// Bins de la PSD como maximo (el segmento no baja de PSD_LEN_MIN)
+#define APP_PSD_BINS_MAX    (FFT_LEN_MAX / APP_PSD_DIVIDER / 2)
+
+// Latidos que entran en un bloque filtrado (a 250 Hz un bloque dura 64 ms,
+// menos que el periodo refractario, el segundo es por la busqueda hacia atras)
+#define APP_CHUNK_BEATS     2
+
+// Frecuencia de la red (50 o 60 Hz), la cancela el notch de la cadena IIR o el cancelador adaptivo
+#ifndef NOTCH_F0
+#define NOTCH_F0            50.0
+#endif
+// Cancela la red y sus armonicas con un LMS normalizado antes del filtro, en
+// lugar del notch fijo de la cadena IIR (0 para volver al notch, ver mains.h)
+#ifndef APP_MAINS_CANCELLER
+#define APP_MAINS_CANCELLER 1
+#endif
+// Frecuencias de corte del pasabanda (pasaaltos y pasabajos de la cadena IIR)
+#define BP_F1               0.5
+#define BP_F2               40.0
+
+#if APP_LEADS < 1 || APP_LEADS > DSP_IIR_LEADS_MAX
+#error "APP_LEADS tiene que estar entre 1 y DSP_IIR_LEADS_MAX"
+#endif
+#if APP_FIR_FILTER && DSP_FORMAT != DSP_FORMAT_F32
+#error "APP_FIR_FILTER solo esta implementado en float32"
+#endif
+#if FFT_LEN_MAX / APP_PSD_DIVIDER > PSD_LEN_MAX
+#error "PSD_LEN_MAX no alcanza para FFT_LEN_MAX / APP_PSD_DIVIDER"
+#endif
+#if APP_PSD_DIVIDER < 2 || 2 * PSD_LEN_MIN > FFT_LEN_MIN
+#error "El trabajo de la PSD (dos segmentos) tiene que entrar en la RFFT de la ventana"
+#endif
+#if APP_RESULT_SLOTS > SPSC_QUEUE_LEN
+#error "APP_RESULT_SLOTS no puede superar SPSC_QUEUE_LEN"
+#endif
+#if APP_CHUNK_SLOTS > SPSC_QUEUE_LEN
+#error "APP_CHUNK_SLOTS no puede superar SPSC_QUEUE_LEN"
+#endif
+
+// Bloque de muestras listo para procesar
+typedef struct {
+    const q15_t *samples;       // Muestras diezmadas en q15 (1.0 son 2048 cuentas, ver dsp.h), APP_LEADS bloques seguidos
+    uint32_t seq;               // Numero de bloque desde el arranque
+    uint32_t index;             // Buffer de origen
+} sampling_block_t;
+
+// Contadores de la adquisicion
+typedef struct {
+    uint32_t blocks;            // Bloques completados por el DMA
+    uint32_t dropped;           // Bloques perdidos por falta de buffers libres
+    uint32_t processed;         // Bloques devueltos por el consumidor
+} sampling_stats_t;
+
+// Bloque filtrado que se manda apenas sale de la cadena IIR
+typedef struct {
+    uint32_t seq;                               // Numero de bloque de origen
+    float32_t filtered[SAMPLING_BLOCK_LEN];     // Señal filtrada en volts
+#if APP_LEADS > 1
+    float32_t leads[APP_LEADS - 1][SAMPLING_BLOCK_LEN]; // Derivaciones 2 en adelante filtradas en volts
+#endif
+    qrs_beat_t beats[APP_CHUNK_BEATS];          // Latidos detectados con este bloque
+    uint32_t beat_count;                        // Latidos en beats
+    bool hrv_ready;                             // Se completo un segundo y va el resumen de variabilidad
+    hrv_summary_t hrv;                          // Resumen de la variabilidad
+} app_chunk_t;
+
+// Resultado del procesamiento de una ventana de fft_len muestras (los
+// buffers salen de un arena estatico y se vuelven a repartir al cambiar fft_len)
+typedef struct {
+    uint32_t seq;                               // Numero del primer bloque de la ventana
+    float32_t *input;                           // Muestras en volts (fft_len)
+    float32_t *rfft_output_raw;                 // Resultado complejo de RFFT (fft_len, mientras se llena la ventana es el trabajo de la PSD)
+    float32_t *rfft_output_normalized;          // Resultado normalizado de RFFT (fft_len / 2)
+    float32_t *rfft_filtered;                   // RFFT normalizada de la señal filtrada (fft_len / 2)
+    float32_t *filtered;                        // Señal filtrada por la cadena IIR (fft_len)
+    float32_t *psd;                             // PSD de Welch de la señal filtrada (psd_bins)
+    uint32_t psd_bins;                          // Bins de la PSD
+    uint32_t psd_segments;                      // Segmentos promediados (0 si no se completo ninguno)
+} app_result_t;
+
+// Floats de arena por resultado (la PSD con fft_len minimo entra en lo que sobra)
+#define APP_RESULT_ARENA_LEN    (4 * FFT_LEN_MAX + APP_PSD_BINS_MAX)
+
+// Configuracion de la adquisicion que se puede cambiar desde el host
+typedef struct {
+    float32_t fs;               // Frecuencia de muestreo en Hz
+    uint32_t fft_len;           // Muestras por ventana
+} app_config_t;
 
 // Prototipos de funciones
 void app_init(void);
-void send_data(char *label, float32_t *data, uint32_t len);
+bool app_configure(float32_t fs, uint32_t fft_len);
+bool app_dsp_task(void);
+bool app_send_task(void);
+void send_data(const char *label, const float32_t *data, uint32_t len);
+void send_meta(void);
+void send_stats(uint32_t seq);
+void send_beats(uint32_t seq, const qrs_beat_t *beats, uint32_t count);
+void send_hrv(uint32_t seq, const hrv_summary_t *summary);
+void send_profile(uint32_t seq);
 void sampling_start(void);
-bool sampling_is_done(void);
\ No newline at end of file
+void sampling_stop(void);
+bool sampling_is_done(void);
+bool sampling_get_block(sampling_block_t *block);
+void sampling_release_block(sampling_block_t *block);
+void sampling_to_volts(const q15_t *src, float32_t *dst, uint32_t len);
+void sampling_get_stats(sampling_stats_t *dst);
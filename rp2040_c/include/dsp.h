@@ -1,23 +1,156 @@
+#include <stdbool.h>
+
 #include "arm_math.h"
 
 // Definiciones
 
-// Cantidad de muestras
+// Cantidad de muestras al arrancar (el host la puede cambiar, ver protocol_config_t)
 #define FFT_LEN         1024UL
-// Frecuencia de muestreo
+// Ventana minima configurable (potencias de 2)
+#define FFT_LEN_MIN     64UL
+// Frecuencia de muestreo al arrancar
 #define FS              1000.0
 // Tiempo de muestreo
 #define TS              (1 / FS)
+// Limites de la frecuencia de muestreo configurable
+#define FS_MIN          250.0
+#define FS_MAX          10000.0
+
+// Formatos numericos de la cadena de procesamiento
+#define DSP_FORMAT_F32  0
+#define DSP_FORMAT_Q15  15
+#define DSP_FORMAT_Q31  31
+
+// Formato usado por la aplicacion (el M0+ no tiene FPU, cada operacion float es una llamada)
+//
+// En punto fijo la entrada son las cuentas del ADC centradas en media escala:
+// q15 = (cuenta - 2048) << 4 y q31 = (cuenta - 2048) << 20, asi que 1.0
+// equivale a 2048 cuentas (full_scale, en volts). Sin centrar, la continua
+// desborda la RFFT q31. La RFFT de CMSIS baja 1 bit por etapa y devuelve
+// X[k] / len, la magnitud sale en 2.14 (q15) o 2.30 (q31) y la IRFFT q31
+// devuelve x[n] / len. Las funciones que terminan en float ya deshacen esas
+// escalas y entregan volts, igual que la cadena en float32, salvo el bin 0
+// del espectro que queda medido respecto de media escala.
+//
+// La IRFFT q15 de CMSIS deja solo 15 - log2(len) bits utiles, asi que
+// dsp_irfft_q15 pasa el espectro a q31 y antitransforma en q31.
+//
+// SNR contra la cadena float32 (ultima ventana de 1024 muestras a 1 kHz, ECG
+// sintetico de 0.6 Vpp con 0.4 Vpp de 50 Hz, cuantizado a 12 bits). Lo
+// calcula host/tests/test_snr.c con dsp_snr_db y se compara en ctest:
+//   q15: espectro 36.5 dB, espectro filtrado 32.5 dB, señal filtrada 66.4 dB
+//   q31: espectro 47.5 dB, espectro filtrado 45.2 dB, señal filtrada 66.4 dB
+// La señal filtrada sale igual en los dos porque la cadena IIR es q31 en
+// cualquier formato fijo. Los coeficientes q31 y float32 se redondean por
+// separado desde el diseño en double, asi que la diferencia incluye tambien
+// el redondeo de los float32. En q15 el redondeo de la RFFT deja el espectro
+// para mostrar pero no para medir bins chicos, y en los espectros q31 manda
+// la magnitud de CMSIS, que eleva al cuadrado en 2.30 y pierde los bins
+// chicos.
+//
+// Los ciclos por formato (PROFILE_SPECTRUM_INPUT y PROFILE_SPECTRUM_FILTERED)
+// no estan medidos en la placa. En la compilacion en PC el float es por
+// hardware y los tiempos no dicen nada del costo de la emulacion en el M0+,
+// asi que float32 sigue por defecto hasta medirlo con la trama STREAM_PROFILE.
+#ifndef DSP_FORMAT
+#define DSP_FORMAT      DSP_FORMAT_F32
+#endif
+
+// Ventana maxima configurable, fija el tamaño de los buffers estaticos. En
+// punto fijo se suman las ventanas q15/q31 de la aplicacion, asi que se limita
+// a la mitad. La compilacion en PC verifica que data + bss del firmware entre
+// en APP_RAM_BUDGET (232 kB de los 256 kB de SRAM principal, ver
+// host/CMakeLists.txt): en float32 ocupa 179 kB, 215 kB con el FIR y 228 kB
+// con el FIR y cuatro derivaciones.
+#ifndef FFT_LEN_MAX
+#if DSP_FORMAT == DSP_FORMAT_F32
+#define FFT_LEN_MAX     4096UL
+#else
+#define FFT_LEN_MAX     2048UL
+#endif
+#endif
+
+// Muestras de la memoria de trabajo estatica
+#define DSP_SCRATCH_LEN FFT_LEN_MAX
+
+// Etapas de la cadena IIR: pasaaltos, pasabajos y notch (una biquad cada uno)
+#define DSP_IIR_STAGES  3
+// Factor de calidad del notch (ancho de banda de f0 / Q)
+#define DSP_NOTCH_Q     30.0f
+// Corrimiento de salida de las biquads q31 (coeficientes de hasta +-4)
+#define DSP_IIR_Q31_SHIFT   2
+// Derivaciones que puede filtrar la cadena IIR a la vez (en float32 van de a
+// pares por la biquad estereo de CMSIS, que carga cada coeficiente una vez
+// para las dos señales intercaladas; en q31 CMSIS no la tiene y cada una
+// tiene su estado con los mismos coeficientes)
+#define DSP_IIR_LEADS_MAX   4
+
+// Contexto del DSP
+typedef struct {
+    // Instancia para la RFFT
+    arm_rfft_fast_instance_f32 rfft_instance;
+    // Instancias para la RFFT y la IRFFT en punto fijo
+    arm_rfft_instance_q15 rfft_q15_instance;
+    arm_rfft_instance_q31 rfft_q31_instance;
+    arm_rfft_instance_q31 irfft_q31_instance;
+    // Memoria de trabajo para no destruir el origen (ninguna funcion usa dos
+    // formatos a la vez, asi que comparten la memoria)
+    union {
+        float32_t scratch[DSP_SCRATCH_LEN];
+        q15_t scratch_q15[DSP_SCRATCH_LEN];
+        // La IRFFT en punto fijo lee len + 2 valores (llega hasta Nyquist)
+        q31_t scratch_q31[DSP_SCRATCH_LEN + 2];
+    } __ALIGNED(8);
+    // Cadena IIR en float32 (forma directa II transpuesta)
+    arm_biquad_cascade_df2T_instance_f32 iir_instance;
+    float32_t iir_coeffs[5 * DSP_IIR_STAGES];
+    float32_t iir_state[2 * DSP_IIR_STAGES];
+    // La misma cadena para pares de derivaciones intercaladas
+    arm_biquad_cascade_stereo_df2T_instance_f32 iir_stereo_instance[DSP_IIR_LEADS_MAX / 2];
+    float32_t iir_stereo_state[DSP_IIR_LEADS_MAX / 2][4 * DSP_IIR_STAGES];
+    // Cadena IIR en q31 con acumulador de 64 bits (los polos del pasaaltos estan muy cerca de 1), una por derivacion
+    arm_biquad_cas_df1_32x64_ins_q31 iir_q31_instance[DSP_IIR_LEADS_MAX];
+    q31_t iir_q31_coeffs[5 * DSP_IIR_STAGES];
+    q63_t iir_q31_state[DSP_IIR_LEADS_MAX][4 * DSP_IIR_STAGES];
+} dsp_context_t;
 
 // Prototipos de funciones
 
 void dsp_init(void);
+bool dsp_set_len(uint32_t len);
 void dsp_rfft(float32_t *src, float32_t *dst, uint32_t len);
+void dsp_rfft_inplace(float32_t *src, float32_t *dst, uint32_t len);
 void dsp_notch_filter(float32_t *src, float32_t f0, float32_t fs, uint32_t len);
 void dsp_bp_filter(float32_t *src, float32_t f1, float32_t f2, float32_t fs, uint32_t len);
 void dsp_rfft_normalize(float32_t *src, float32_t *dst, uint32_t len);
 void dsp_irfft(float32_t *src, float32_t *dst, uint32_t len);
+void dsp_irfft_inplace(float32_t *src, float32_t *dst, uint32_t len);
 void dsp_irfft_normalize(float32_t *src, float32_t *dst, uint32_t len);
+float32_t dsp_snr_db(const float32_t *ref, const float32_t *test, uint32_t len);
+
+void dsp_iir_init(float32_t f_hp, float32_t f_lp, float32_t f_notch, float32_t fs);
+void dsp_iir(const float32_t *src, float32_t *dst, uint32_t len);
+void dsp_iir_q31(const q31_t *src, q31_t *dst, uint32_t len);
+void dsp_iir_leads(float32_t *const *leads, uint32_t count, uint32_t len);
+void dsp_iir_leads_q31(q31_t *const *leads, uint32_t count, uint32_t len);
+void dsp_q15_to_volts(const q15_t *src, float32_t *dst, float32_t full_scale, uint32_t len);
+void dsp_q31_to_volts(const q31_t *src, float32_t *dst, float32_t full_scale, uint32_t len);
+void dsp_volts_to_q31(const float32_t *src, q31_t *dst, float32_t full_scale, uint32_t len);
+
+void dsp_counts_to_q15(const uint16_t *src, q15_t *dst, uint32_t len);
+void dsp_lowpass_q15(q15_t *coeffs, uint32_t taps, float32_t fc, float32_t fs);
+void dsp_rfft_q15(q15_t *src, q15_t *dst, uint32_t len);
+void dsp_notch_filter_q15(q15_t *src, float32_t f0, float32_t fs, uint32_t len);
+void dsp_bp_filter_q15(q15_t *src, float32_t f1, float32_t f2, float32_t fs, uint32_t len);
+void dsp_rfft_normalize_q15(const q15_t *src, float32_t *dst, float32_t full_scale, uint32_t len);
+void dsp_irfft_q15(const q15_t *src, float32_t *dst, float32_t full_scale, uint32_t len);
+
+void dsp_counts_to_q31(const uint16_t *src, q31_t *dst, uint32_t len);
+void dsp_rfft_q31(q31_t *src, q31_t *dst, uint32_t len);
+void dsp_notch_filter_q31(q31_t *src, float32_t f0, float32_t fs, uint32_t len);
+void dsp_bp_filter_q31(q31_t *src, float32_t f1, float32_t f2, float32_t fs, uint32_t len);
+void dsp_rfft_normalize_q31(const q31_t *src, float32_t *dst, float32_t full_scale, uint32_t len);
+void dsp_irfft_q31(q31_t *src, float32_t *dst, float32_t full_scale, uint32_t len);
 
 // Prototipos inline
 
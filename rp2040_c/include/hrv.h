@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "arm_math.h"
+
+// Variabilidad de la frecuencia cardiaca sobre una ventana movil de latidos
+//
+// Cada latido (muestra del pico R mas su fraccion, ver qrs.h) agrega un
+// intervalo RR en microsegundos y los que quedan fuera de HRV_WINDOW_S salen
+// de la ventana. Las sumas del dominio del tiempo son enteras, asi entrar y
+// salir cuesta O(1) y no acumula error:
+//   SDNN    desvio de los RR           (suma y suma de cuadrados)
+//   RMSSD   raiz de la media de las diferencias sucesivas al cuadrado
+//   pNN50   porcentaje de diferencias sucesivas mayores a 50 ms
+// Los RR fuera de HRV_RR_MIN_MS a HRV_RR_MAX_MS (latidos perdidos o falsos)
+// no entran y cortan la cadena de diferencias y el tacograma: el hueco no se
+// remuestrea y el proximo RR valido arranca de nuevo los pasabandas.
+//
+// Para LF/HF el tacograma se remuestrea a HRV_RESAMPLE_FS por interpolacion
+// lineal entre latidos, se le resta el primer RR y pasa por dos pasabandas de
+// Butterworth de cuarto orden (LF de 0.04 a 0.15 Hz y HF de 0.15 a 0.4 Hz). La potencia de
+// cada banda es la media del cuadrado de su salida en la misma ventana: los
+// cuadrados se suman por segundo y la ventana avanza de a un segundo, con una
+// suma movil que se recalcula entera cada vez que da la vuelta.
+
+// Ventana de la variabilidad en segundos
+#define HRV_WINDOW_S        300
+// Intervalos guardados (potencia de 2, cubre la ventana hasta 200 lpm; por
+// encima sale el mas viejo antes de tiempo)
+#define HRV_INTERVALS_LEN   1024
+// Diferencia de un intervalo cuyo anterior no era valido
+#define HRV_NO_DIFF         INT32_MIN
+// Intervalos RR validos en ms
+#define HRV_RR_MIN_MS       250
+#define HRV_RR_MAX_MS       2000
+// Diferencia sucesiva que cuenta para pNN50 en ms
+#define HRV_NN50_MS         50
+// Frecuencia de remuestreo del tacograma y muestras en la ventana (la
+// potencia se guarda de a un segundo, HRV_WINDOW_S sumas por banda)
+#define HRV_RESAMPLE_FS     4
+#define HRV_POWER_LEN       (HRV_WINDOW_S * HRV_RESAMPLE_FS)
+// Bandas de frecuencia en Hz
+#define HRV_LF_LOW          0.04f
+#define HRV_LF_HIGH         0.15f
+#define HRV_HF_LOW          0.15f
+#define HRV_HF_HIGH         0.4f
+// Biquads de cada pasabanda (pasaaltos y pasabajos de Butterworth de cuarto orden)
+#define HRV_BAND_STAGES     4
+
+// Resumen de la ventana, asi se manda en STREAM_HRV (todo float32)
+typedef struct {
+    float intervals;            // Intervalos RR en la ventana
+    float span_s;               // Segundos que cubren
+    float mean_rr_ms;           // RR medio
+    float heart_rate_bpm;       // Frecuencia cardiaca media
+    float sdnn_ms;              // Desvio de los RR
+    float rmssd_ms;             // Raiz de la media de las diferencias sucesivas al cuadrado
+    float pnn50;                // Porcentaje de diferencias sucesivas mayores a 50 ms
+    float lf_ms2;               // Potencia de 0.04 a 0.15 Hz
+    float hf_ms2;               // Potencia de 0.15 a 0.4 Hz
+    float lf_hf;                // Relacion LF / HF
+} hrv_summary_t;
+
+// Intervalo guardado en la ventana
+typedef struct {
+    int32_t rr_us;              // Intervalo RR
+    int32_t diff_us;            // Diferencia con el anterior (HRV_NO_DIFF si no hay)
+} hrv_interval_t;
+
+// Pasabanda del tacograma y suma movil del cuadrado de su salida
+typedef struct {
+    arm_biquad_cascade_df2T_instance_f32 instance;
+    float32_t coeffs[5 * HRV_BAND_STAGES];
+    float32_t state[2 * HRV_BAND_STAGES];
+    float32_t power[HRV_WINDOW_S];
+    float32_t sum;
+} hrv_band_t;
+
+// Estado de la variabilidad
+typedef struct {
+    // Frecuencia de muestreo de los latidos
+    float32_t fs;
+    // Ultimo latido en muestras (entera y fraccion)
+    bool has_beat;
+    uint32_t last_sample;
+    float32_t last_offset;
+    // Ultimo intervalo valido (0 si el anterior se descarto)
+    int32_t last_rr_us;
+    // Intervalos de la ventana, del mas viejo (tail) al mas nuevo (head)
+    hrv_interval_t intervals[HRV_INTERVALS_LEN];
+    uint32_t head;
+    uint32_t tail;
+    // Sumas de la ventana
+    int64_t sum_rr_us;
+    int64_t sum_rr2_us2;
+    int64_t sum_diff2_us2;
+    uint32_t diffs;
+    uint32_t nn50;
+    // Tacograma remuestreado: tiempo de la proxima muestra en us desde el ultimo latido
+    // y RR de referencia que se le resta
+    int64_t resample_us;
+    int32_t baseline_us;
+    // Pasabandas LF y HF con sus potencias
+    hrv_band_t lf;
+    hrv_band_t hf;
+    // Muestra del tacograma en la ventana y muestras sumadas en las potencias
+    uint32_t power_index;
+    uint32_t power_count;
+} hrv_t;
+
+// Prototipos de funciones
+void hrv_init(hrv_t *hrv, float32_t fs);
+void hrv_add_beat(hrv_t *hrv, uint32_t sample, float32_t offset);
+void hrv_get(const hrv_t *hrv, hrv_summary_t *dst);
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "arm_math.h"
+
+// Cancelador adaptivo de la interferencia de la red (50 o 60 Hz y armonicas)
+//
+// La referencia es la suma de las armonicas de f0 que entran por debajo de
+// fs / 2 (hasta MAINS_HARMONICS), sintetizada muestra a muestra con un
+// acumulador de fase de 32 bits y arm_sin_q31 (la fase de la armonica h es h
+// veces la de la fundamental, asi que no derivan entre si). Un LMS
+// normalizado de CMSIS filtra la referencia para igualar la amplitud y la
+// fase de cada armonica en la señal y la resta: la salida es el error del
+// LMS. La ventana del LMS cubre una onda de f0, asi el seno y el coseno de
+// cada armonica son ortogonales en la ventana y todas convergen igual de
+// rapido (con media onda la fundamental tarda segundos en converger).
+//
+// Se comporta como un notch de ancho ~ 1 / (pi * MAINS_TIME_MS) alrededor de
+// cada armonica que sigue los cambios de amplitud y de fase de la red. El paso
+// se elige para que cada armonica converja con esa constante de tiempo
+// (mu = 2 * armonicas / (fs * tiempo), la energia de la referencia se reparte
+// entre ellas). Hay una version en float32 y otra en q31 con el mismo estado
+// de fase, la aplicacion usa la de su formato.
+//
+// La referencia queda en la f0 nominal, asi que si la red se corre df el LMS
+// sigue una fase que rota y la atenuacion queda en ~ 1 / (2 * pi * df *
+// tiempo). Con 50 ms (host/tests/test_mains.c) la red exacta baja mas de
+// 100 dB, con 0.2 Hz de corrimiento 23 dB, con 0.5 Hz 15 dB y con 1 Hz 10 dB; a
+// cambio el notch mide ~ 6 Hz de ancho en lugar de los ~ 1.7 Hz del notch de
+// la cadena IIR. Con 200 ms el notch mide 1.6 Hz pero 0.2 Hz de corrimiento
+// solo bajan 12 dB.
+//
+// Por encima de MAINS_TAPS_MAX * f0 la onda no entra en la ventana y
+// mains_init devuelve false: la señal pasa sin tocar y la aplicacion vuelve al
+// notch de la cadena IIR.
+
+// Armonicas de f0 como maximo (las que no entran por debajo de fs / 2 se descartan)
+#define MAINS_HARMONICS     3
+// Coeficientes del LMS como maximo (fs hasta 2 kHz con 50 Hz y 2.4 kHz con 60 Hz)
+#define MAINS_TAPS_MAX      40
+// Constante de tiempo de la adaptacion en ms
+#define MAINS_TIME_MS       50
+// Muestras que se le pasan al LMS de una vez (fija el largo de los estados)
+#define MAINS_BLOCK_LEN     16
+// Corrimiento de salida del LMS q31 (los coeficientes representan hasta 2^MAINS_Q31_SHIFT)
+#define MAINS_Q31_SHIFT     2
+
+// Estado del cancelador
+typedef struct {
+    // Armonicas usadas (0 deja pasar la señal sin tocarla) y coeficientes del LMS
+    uint32_t harmonics;
+    uint16_t taps;
+    // Fase de la fundamental y su incremento por muestra (2^32 es una vuelta)
+    uint32_t phase;
+    uint32_t phase_step;
+    // Amplitud de cada armonica en la referencia
+    q31_t amplitude;
+    // Referencia del bloque en curso
+    q31_t reference_q31[MAINS_BLOCK_LEN];
+    float32_t reference[MAINS_BLOCK_LEN];
+    // LMS en float32
+    arm_lms_norm_instance_f32 lms;
+    float32_t coeffs[MAINS_TAPS_MAX];
+    float32_t state[MAINS_TAPS_MAX + MAINS_BLOCK_LEN - 1];
+    // LMS en q31
+    arm_lms_norm_instance_q31 lms_q31;
+    q31_t coeffs_q31[MAINS_TAPS_MAX];
+    q31_t state_q31[MAINS_TAPS_MAX + MAINS_BLOCK_LEN - 1];
+    // Estimacion de la interferencia (salida del FIR, se descarta)
+    float32_t estimate[MAINS_BLOCK_LEN];
+    q31_t estimate_q31[MAINS_BLOCK_LEN];
+} mains_t;
+
+// Prototipos de funciones
+bool mains_init(mains_t *mains, float32_t f0, float32_t fs);
+void mains_cancel(mains_t *mains, float32_t *src, float32_t *dst, uint32_t len);
+void mains_cancel_q31(mains_t *mains, q31_t *src, q31_t *dst, uint32_t len);
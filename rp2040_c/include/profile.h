@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+#include "pico/stdlib.h"
+
+// Mide cuanto tarda cada etapa con el timer de 1 us del RP2040 (es el mismo
+// para los dos nucleos). Cada etapa la escribe un solo contexto (nucleo 1,
+// nucleo 0 o la interrupcion del DMA) y el reporte arranca un periodo nuevo
+// cambiando la epoca: el que escribe reinicia sus contadores la proxima vez
+// que mide, asi nadie escribe contadores ajenos. El reporte puede leer una
+// etapa a mitad de actualizar, lo que a lo sumo corre una muestra de periodo.
+
+// Mide las etapas (0 deja las llamadas vacias)
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED 1
+#endif
+
+// Etapas medidas
+typedef enum {
+    PROFILE_DMA_IRQ = 0,        // Interrupcion del DMA (por bloque)
+    PROFILE_FILTER,             // Volts y cadena IIR (por bloque)
+    PROFILE_SPECTRUM_INPUT,     // RFFT y magnitud de la entrada (por ventana)
+    PROFILE_SPECTRUM_FILTERED,  // RFFT y magnitud de la señal filtrada (por ventana)
+    PROFILE_SEND_FILTERED,      // Trama del bloque filtrado (por bloque)
+    PROFILE_SEND_RESULT,        // Tramas de la ventana y contadores (por ventana)
+    PROFILE_PSD,                // Segmentos de Welch de la señal filtrada (por bloque)
+    PROFILE_QRS,                // Detector de QRS sobre la señal filtrada (por bloque)
+    PROFILE_HRV,                // Variabilidad de los latidos del bloque (por bloque)
+    PROFILE_DECIMATE,           // FIR de diezmado del ADC, dentro de la interrupcion del DMA (por bloque)
+    PROFILE_STAGES
+} profile_stage_t;
+
+// Contadores de una etapa en el periodo actual
+typedef struct {
+    uint32_t epoch;             // Periodo al que pertenecen los contadores
+    uint32_t count;             // Mediciones
+    uint32_t total_us;          // Suma de duraciones
+    uint32_t min_us;            // Duracion minima
+    uint32_t max_us;            // Duracion maxima
+} profile_counter_t;
+
+// Resumen de una etapa, asi se manda en STREAM_PROFILE
+typedef struct {
+    uint32_t count;             // Mediciones en el periodo
+    uint32_t min_us;            // Duracion minima
+    uint32_t mean_us;           // Duracion media
+    uint32_t max_us;            // Duracion maxima
+    uint32_t budget_us;         // Tiempo disponible por ejecucion (periodo de la etapa)
+} profile_report_t;
+
+// Prototipos de funciones
+void profile_set_budget(profile_stage_t stage, uint32_t budget_us);
+void profile_snapshot(profile_report_t *dst);
+
+#if PROFILE_ENABLED
+void profile_stop(profile_stage_t stage, uint64_t start);
+#endif
+
+// Prototipos inline
+
+/**
+ * @brief Marca el inicio de una etapa
+ * @return tiempo actual en us
+*/
+static inline uint64_t profile_start(void) {
+#if PROFILE_ENABLED
+    return time_us_64();
+#else
+    return 0;
+#endif
+}
+
+#if !PROFILE_ENABLED
+/**
+ * @brief Sin mediciones no hace nada
+ * @param stage etapa medida
+ * @param start valor de profile_start
+*/
+static inline void profile_stop(profile_stage_t stage, uint64_t start) {
+    (void) stage;
+    (void) start;
+}
+#endif
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Formato de trama binaria (todo little-endian)
+//
+//  offset  tamaño  campo
+//  0       2       sincronismo (0xA5 0x5A)
+//  2       1       identificador de flujo (protocol_stream_t)
+//  3       1       tipo de dato del payload (protocol_dtype_t)
+//  4       4       numero de secuencia (bloque de origen)
+//  8       2       cantidad de elementos
+//  10      n       payload
+//  10 + n  2       CRC-16/CCITT-FALSE de los bytes 2 a 9 + n
+
+// Bytes de sincronismo
+#define PROTOCOL_SYNC0      0xA5
+#define PROTOCOL_SYNC1      0x5A
+// Largo del encabezado
+#define PROTOCOL_HEADER_LEN 10
+// Largo del CRC
+#define PROTOCOL_CRC_LEN    2
+
+// Identificadores de flujo
+typedef enum {
+    STREAM_FREQS = 0,           // Bins de frecuencia
+    STREAM_IFFT_REAL,           // Muestras en volts
+    STREAM_FFT_REAL,            // Espectro normalizado
+    STREAM_TIME,                // Bins de tiempo
+    STREAM_IFFT_FILTERED,       // Señal filtrada por ventana (ya no se manda, ver STREAM_FILTERED)
+    STREAM_FFT_FILTERED,        // Espectro filtrado normalizado
+    STREAM_STATS,               // Contadores de la adquisicion
+    STREAM_META,                // Configuracion de la sesion (protocol_meta_t)
+    STREAM_FILTERED,            // Señal filtrada por bloque de DMA (baja latencia)
+    STREAM_PROFILE,             // Tiempos por etapa (profile_report_t)
+    STREAM_PSD,                 // PSD de Welch de la señal filtrada en V^2/Hz (bins i * fs / (2 * count))
+    STREAM_BEATS,               // Latidos detectados en el bloque (qrs_beat_t como bytes)
+    STREAM_HRV,                 // Resumen de variabilidad de la ventana, una vez por segundo (hrv_summary_t)
+    STREAM_LEADS,               // Derivaciones 2 en adelante filtradas por bloque de DMA (una detras de otra, leads - 1 en total)
+} protocol_stream_t;
+
+// Comandos del host: misma trama en sentido contrario, con el comando en el
+// lugar del identificador de flujo y el payload como bytes (PROTOCOL_U8)
+typedef enum {
+    COMMAND_CONFIG = 0x80,      // Cambia fs y fft_len (protocol_config_t), contesta con STREAM_META
+} protocol_command_t;
+
+// Tipos de dato del payload
+typedef enum {
+    PROTOCOL_F32 = 0,
+    PROTOCOL_U32,
+    PROTOCOL_I16,
+    PROTOCOL_U16,
+    PROTOCOL_U8,
+} protocol_dtype_t;
+
+// Configuracion de la sesion, se manda como bytes (PROTOCOL_U8) al conectarse
+// el host y cada vez que cambia. Con esto el host arma los ejes de frecuencia
+// (i * fs / fft_len) y de tiempo (i / fs) sin que viajen en cada bloque.
+typedef struct {
+    float fs;                   // Frecuencia de muestreo en Hz
+    uint32_t fft_len;           // Muestras por ventana de FFT
+    float volts_per_count;      // Escala del ADC
+    float notch_f0;             // Frecuencia del notch en Hz
+    float bp_f1;                // Corte inferior del pasabanda en Hz
+    float bp_f2;                // Corte superior del pasabanda en Hz
+    uint32_t leads;             // Derivaciones capturadas (la primera va en STREAM_FILTERED y el resto en STREAM_LEADS)
+} protocol_meta_t;
+
+// Configuracion pedida con COMMAND_CONFIG. Si no es valida la placa sigue como
+// estaba y manda la STREAM_META de siempre, asi el host ve que no cambio.
+typedef struct {
+    float fs;                   // Frecuencia de muestreo en Hz (FS_MIN a FS_MAX)
+    uint32_t fft_len;           // Muestras por ventana (potencia de 2, FFT_LEN_MIN a FFT_LEN_MAX)
+} protocol_config_t;
+
+// Payload maximo de un comando
+#define PROTOCOL_RX_PAYLOAD_LEN 16
+
+// Receptor de comandos (se alimenta de a un byte)
+typedef struct {
+    uint8_t buffer[PROTOCOL_HEADER_LEN + PROTOCOL_RX_PAYLOAD_LEN + PROTOCOL_CRC_LEN];
+    uint32_t len;               // Bytes de la trama en curso
+    uint8_t command;            // Comando de la ultima trama completa
+    const uint8_t *payload;     // Payload de la ultima trama completa
+    uint32_t size;              // Bytes de payload de la ultima trama completa
+} protocol_rx_t;
+
+// Prototipos de funciones
+void protocol_send(uint8_t stream, uint8_t dtype, uint32_t seq, const void *data, uint16_t count);
+bool protocol_receive(protocol_rx_t *rx, uint8_t byte);
+uint16_t protocol_crc16(uint16_t crc, const uint8_t *data, uint32_t len);
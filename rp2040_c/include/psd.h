@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "arm_math.h"
+
+// Densidad espectral de potencia por el metodo de Welch
+//
+// La señal se corta en segmentos de len muestras solapados al 50 %. Cada vez
+// que llegan len / 2 muestras nuevas se completa un segmento, se multiplica
+// por la ventana (calculada una sola vez en psd_init), se transforma y se
+// suma |X[k]|^2 al acumulador. psd_get deja en el acumulador el promedio de
+// los segmentos sumados desde psd_start, en V^2 / Hz de un solo lado:
+//
+//   P[k] = 2 * sum(|X[k]|^2) / (segmentos * fs * sum(w^2))    (sin duplicar el bin 0)
+//
+// El trabajo se reparte a medida que llegan los bloques: una RFFT de len
+// muestras cada len / 2, sin picos al cerrar la ventana de la aplicacion.
+//
+// El acumulador (len / 2 valores) y la memoria de trabajo de la RFFT (2 * len
+// valores) no son del estimador: los pasa psd_start en cada ventana, asi la
+// aplicacion los toma del resultado que se esta llenando en lugar de tener
+// otra copia fija del largo maximo.
+
+// Segmento mas largo y mas corto (la RFFT de CMSIS arranca en 32)
+#ifndef PSD_LEN_MAX
+#define PSD_LEN_MAX     1024UL
+#endif
+#define PSD_LEN_MIN     32UL
+
+// Ventanas disponibles
+typedef enum {
+    PSD_WINDOW_RECT = 0,
+    PSD_WINDOW_HANNING,
+    PSD_WINDOW_HAMMING,
+    PSD_WINDOW_BLACKMAN_HARRIS,     // 92 dB de rechazo de lobulos laterales
+} psd_window_t;
+
+// Estado del estimador
+typedef struct {
+    // RFFT del largo del segmento
+    arm_rfft_fast_instance_f32 rfft_instance;
+    // Muestras por segmento y muestras en el buffer
+    uint32_t len;
+    uint32_t fill;
+    // Segmentos sumados desde psd_start
+    uint32_t segments;
+    // Escala de un segmento a V^2 / Hz
+    float32_t scale;
+    // Ventana precalculada
+    float32_t window[PSD_LEN_MAX];
+    // Ultimas len muestras (la mitad vieja es la mitad nueva del segmento anterior)
+    float32_t buffer[PSD_LEN_MAX];
+    // Potencia de cada bin sumada sobre los segmentos (NULL antes de psd_start)
+    float32_t *power;
+    // Segmento con ventana seguido de su RFFT (2 * len valores alineados a 8 bytes)
+    float32_t *work;
+} psd_t;
+
+// Prototipos de funciones
+bool psd_init(psd_t *psd, uint32_t len, psd_window_t window, float32_t fs);
+void psd_start(psd_t *psd, float32_t *power, float32_t *work);
+void psd_add(psd_t *psd, const float32_t *src, uint32_t count);
+uint32_t psd_get(psd_t *psd);
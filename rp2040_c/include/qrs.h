@@ -0,0 +1,134 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "arm_math.h"
+
+// Detector de QRS de Pan-Tompkins en punto fijo, muestra a muestra
+//
+// La entrada es la señal ya filtrada en q31 (1.0 = full_scale volts). Etapas:
+//   pasabanda   pasaaltos y pasabajos de Butterworth (5 a 15 Hz) en q31 con acumulador de 64 bits
+//   derivada    (2 x[n] + x[n - s] - x[n - 3 s] - 2 x[n - 4 s]) / 8, con s = fs / 200 como en el original
+//   cuadrado    de la derivada, en 30 bits
+//   integracion suma movil de QRS_WINDOW_MS (no se divide, los umbrales son relativos)
+// Cada maximo de la integracion (el mayor dentro de un periodo refractario,
+// asi que la decision sale con ese retardo) se compara con los umbrales adaptivos
+// (SPKI, NPKI, THRESHOLD I1 = NPKI + (SPKI - NPKI) / 4 y THRESHOLD I2 = I1 / 2).
+// Hay periodo refractario, descarte de ondas T por pendiente y busqueda hacia
+// atras cuando pasa 1.66 veces el RR medio sin latido. Los dos primeros
+// segundos solo aprenden los niveles iniciales.
+//
+// Los tiempos (refractario, onda T, busqueda hacia atras) se miden entre
+// maximos de la integracion. El latido se ubica en el maximo de |entrada -
+// media| dentro de la ventana de integracion, asi cae en el pico R de la señal
+// que recibe el detector y no en uno de los lobulos que deja el pasabanda, y
+// una parabola por el pico y sus dos vecinas lo corre una fraccion de muestra.
+//
+// Por encima de QRS_FS_MAX el detector toma una de cada decim muestras (la
+// entrada ya viene con el pasabajos de la cadena, muy por debajo de la nueva
+// Nyquist) y la historia no crece con fs. Los latidos se devuelven en
+// muestras de la señal: la posicion diezmada mas la fraccion de la parabola,
+// por decim.
+
+// Frecuencia maxima a la que corre el detector (fija el largo de la historia)
+#define QRS_FS_MAX          2000
+// Historia de la entrada y del cuadrado (potencia de 2 mayor a la ventana)
+#define QRS_HISTORY_LEN     512
+// Historia del pasabanda para la derivada (potencia de 2 mayor a 4 * QRS_FS_MAX / 200)
+#define QRS_BAND_LEN        64
+// Ventana de integracion, periodo refractario, limite de onda T y aprendizaje en ms
+#define QRS_WINDOW_MS       150
+#define QRS_REFRACTORY_MS   200
+#define QRS_TWAVE_MS        360
+#define QRS_LEARN_MS        2000
+// Intervalos RR promediados para la busqueda hacia atras
+#define QRS_RR_AVERAGE      8
+// Muestras filtradas de una vez
+#define QRS_BLOCK_LEN       16
+// Biquads del pasabanda y corrimiento de salida de las biquads q31
+#define QRS_BP_STAGES       2
+#define QRS_BP_SHIFT        2
+
+#if QRS_FS_MAX * QRS_WINDOW_MS / 1000 >= QRS_HISTORY_LEN
+#error "QRS_HISTORY_LEN tiene que cubrir la ventana de integracion a QRS_FS_MAX"
+#endif
+#if 4 * QRS_FS_MAX / 200 >= QRS_BAND_LEN
+#error "QRS_BAND_LEN tiene que cubrir la derivada a QRS_FS_MAX"
+#endif
+
+// Latido detectado, asi se manda en STREAM_BEATS
+typedef struct {
+    uint32_t sample;            // Muestra del pico (numero de bloque * SAMPLING_BLOCK_LEN + posicion)
+    float amplitude;            // Valor de la entrada en el pico en volts
+    uint32_t rr;                // Muestras desde el latido anterior (0 en el primero)
+    float offset;               // Fraccion de muestra del pico por ajuste parabolico (-0.5 a 0.5)
+} qrs_beat_t;
+
+// Maximo de la integracion con su pico R
+typedef struct {
+    int64_t peak;               // Valor de la integracion
+    uint32_t peak_pos;          // Muestra del maximo de la integracion
+    uint32_t pos;               // Muestra del pico R
+    q31_t value;                // Entrada en el pico R
+    float32_t offset;           // Fraccion de muestra del pico R
+    int32_t slope;              // Maximo del cuadrado de la derivada en la ventana
+} qrs_peak_t;
+
+// Estado del detector
+typedef struct {
+    // Pasabanda
+    arm_biquad_cas_df1_32x64_ins_q31 bp_instance;
+    q31_t bp_coeffs[5 * QRS_BP_STAGES];
+    q63_t bp_state[4 * QRS_BP_STAGES];
+    q31_t bp_input[QRS_BLOCK_LEN];
+    q31_t bp_block[QRS_BLOCK_LEN];
+    // Historia de la entrada, del pasabanda y del cuadrado de la derivada
+    q31_t input[QRS_HISTORY_LEN];
+    q31_t band[QRS_BAND_LEN];
+    int32_t squared[QRS_HISTORY_LEN];
+    // Muestras de la señal recibidas y muestras diezmadas procesadas desde qrs_init
+    uint32_t count;
+    uint32_t pos;
+    // Muestras de la señal por muestra procesada
+    uint32_t decim;
+    // Parametros en muestras diezmadas
+    uint32_t stride;
+    uint32_t window;
+    uint32_t refractory;
+    uint32_t twave;
+    uint32_t learn;
+    // Volts que representa 1.0 en q31
+    float32_t full_scale;
+    // Suma de la entrada en la ventana (su media es la linea de base del pico R)
+    int64_t input_sum;
+    // Integracion movil y su tendencia
+    int64_t mwi;
+    int64_t mwi_prev;
+    bool rising;
+    // Aprendizaje inicial
+    int64_t learn_max;
+    int64_t learn_sum;
+    // Niveles de señal y de ruido y umbral principal
+    int64_t spki;
+    int64_t npki;
+    int64_t threshold;
+    // Ultimo latido (pico R en muestras de la señal y maximo de la integracion)
+    bool has_beat;
+    uint32_t last_sample;
+    uint32_t last_pos;
+    uint32_t last_peak_pos;
+    int32_t last_slope;
+    // Ultimos intervalos RR y su promedio en muestras diezmadas
+    uint32_t rr[QRS_RR_AVERAGE];
+    uint32_t rr_count;
+    uint32_t rr_mean;
+    // Mayor maximo local todavia sin confirmar (peak en 0 si no hay)
+    qrs_peak_t held;
+    // Maximo que quedo entre I2 e I1, candidato de la busqueda hacia atras (peak en 0 si no hay)
+    qrs_peak_t candidate;
+} qrs_t;
+
+// Prototipos de funciones
+void qrs_init(qrs_t *qrs, float32_t fs, float32_t full_scale);
+uint32_t qrs_process(qrs_t *qrs, const q31_t *src, uint32_t len, uint32_t first_sample, qrs_beat_t *beats, uint32_t max_beats);
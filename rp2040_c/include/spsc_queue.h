@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Capacidad de la cola (tiene que ser potencia de 2)
+#define SPSC_QUEUE_LEN  16
+
+/**
+ * @brief Cola sin locks de un productor y un consumidor
+ * 
+ * El productor solo escribe head y el consumidor solo escribe tail, asi que
+ * alcanza con cargas y escrituras atomicas de 32 bits (el M0+ no tiene
+ * LDREX/STREX). Sirve entre una interrupcion y el lazo principal o entre
+ * los dos nucleos.
+*/
+typedef struct {
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint32_t items[SPSC_QUEUE_LEN];
+} spsc_queue_t;
+
+/**
+ * @brief Vacia la cola
+ * @param q puntero a cola
+*/
+static inline void spsc_queue_init(spsc_queue_t *q) {
+    q->head = 0;
+    q->tail = 0;
+}
+
+/**
+ * @brief Agrega un elemento (solo desde el productor)
+ * @param q puntero a cola
+ * @param item elemento a agregar
+ * @return devuelve false si la cola esta llena
+*/
+static inline bool spsc_queue_push(spsc_queue_t *q, uint32_t item) {
+    // Indices actuales
+    uint32_t head = q->head;
+    uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+    // Veo si hay lugar
+    if(head - tail == SPSC_QUEUE_LEN) { return false; }
+    // Escribo el elemento antes de publicarlo
+    q->items[head & (SPSC_QUEUE_LEN - 1)] = item;
+    __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief Saca un elemento (solo desde el consumidor)
+ * @param q puntero a cola
+ * @param item puntero a donde guardar el elemento
+ * @return devuelve false si la cola esta vacia
+*/
+static inline bool spsc_queue_pop(spsc_queue_t *q, uint32_t *item) {
+    // Indices actuales
+    uint32_t tail = q->tail;
+    uint32_t head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+    // Veo si hay algo
+    if(head == tail) { return false; }
+    // Leo el elemento antes de liberar el lugar
+    *item = q->items[tail & (SPSC_QUEUE_LEN - 1)];
+    __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief Cantidad de elementos en la cola
+ * @param q puntero a cola
+ * @return cantidad de elementos
+*/
+static inline uint32_t spsc_queue_count(spsc_queue_t *q) {
+    return __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+}
@@ -1,23 +1,116 @@
-#include <malloc.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "app_tasks.h"
 
-// Variables publicas
-
-// Array para las muestras
-float32_t rfft_input[FFT_LEN] = {0};
-
 // Variables privadas
 
-// Creo un repeating timer
-static repeating_timer_t timer;
-// Flag para indicar que se termino el sampling
-static bool sampling_done = false;
+// Configuracion actual de la adquisicion
+static app_config_t config = { .fs = FS, .fft_len = FFT_LEN };
+// Conversiones del ADC de cada canal de DMA (SAMPLING_OVERSAMPLE por muestra y derivacion, intercaladas, se pasan a q15 en el lugar)
+static uint16_t adc_raw[2][SAMPLING_BLOCK_LEN * SAMPLING_OVERSAMPLE * APP_LEADS] __ALIGNED(4);
+// Bloques diezmados de cada derivacion (los escribe la interrupcion del DMA)
+static q15_t adc_samples[SAMPLING_BUFFERS][APP_LEADS][SAMPLING_BLOCK_LEN] = {0};
+// Bloque de descarte para cuando el consumidor no devuelve buffers a tiempo (el diezmado sigue igual)
+static q15_t adc_discard[APP_LEADS][SAMPLING_BLOCK_LEN];
+// FIR de diezmado de cada derivacion, comparten los coeficientes (se vuelven a diseñar al cambiar fs)
+static arm_fir_decimate_instance_q15 adc_decimator[APP_LEADS];
+static q15_t adc_decim_coeffs[SAMPLING_DECIM_TAPS];
+static q15_t adc_decim_state[APP_LEADS][SAMPLING_DECIM_TAPS + SAMPLING_BLOCK_LEN * SAMPLING_OVERSAMPLE - 1];
+#if APP_LEADS > 1
+// Conversiones de una derivacion separadas del resto
+static q15_t adc_lead[SAMPLING_BLOCK_LEN * SAMPLING_OVERSAMPLE];
+#endif
+// Numero de bloque de cada buffer
+static uint32_t adc_seq[SAMPLING_BUFFERS];
+// Canales de DMA encadenados que vacian el FIFO del ADC
+static uint dma_chan[2];
+// Buffers llenos (de la interrupcion al consumidor)
+static spsc_queue_t ready_queue;
+// Buffers libres (del consumidor a la interrupcion)
+static spsc_queue_t free_queue;
+// Contadores de la adquisicion
+static volatile sampling_stats_t stats = {0};
+
+// Resultados del procesamiento y el arena de donde salen sus buffers
+static app_result_t results[APP_RESULT_SLOTS];
+static float32_t result_arena[APP_RESULT_SLOTS][APP_RESULT_ARENA_LEN] __ALIGNED(8);
+// Resultados listos para mandar (del DSP al envio)
+static spsc_queue_t result_ready_queue;
+// Resultados ya mandados (del envio al DSP)
+static spsc_queue_t result_free_queue;
+// Resultado que se esta llenando y muestras que ya tiene
+static uint32_t window_index;
+static uint32_t window_fill = 0;
+// Bloques filtrados
+static app_chunk_t chunks[APP_CHUNK_SLOTS];
+// Bloques filtrados listos para mandar (del DSP al envio)
+static spsc_queue_t chunk_ready_queue;
+// Bloques filtrados ya mandados (del envio al DSP)
+static spsc_queue_t chunk_free_queue;
+// Hay que volver a mandar la configuracion de la sesion
+static bool meta_pending = true;
+// Comandos que llegan del host
+static protocol_rx_t command_rx = {0};
+#if APP_DUAL_CORE
+// El nucleo 0 pide que el DSP se detenga para reconfigurar y el nucleo 1 avisa que lo hizo
+static volatile bool dsp_pause_request = false;
+static volatile bool dsp_paused = false;
+#endif
+#if DSP_FORMAT == DSP_FORMAT_Q15
+// Ventana de muestras, ventana filtrada y RFFT en q15
+static q15_t fixed_input[FFT_LEN_MAX] __ALIGNED(8);
+static q15_t fixed_filtered[FFT_LEN_MAX] __ALIGNED(8);
+static q15_t fixed_spectrum[2 * FFT_LEN_MAX] __ALIGNED(8);
+#elif DSP_FORMAT == DSP_FORMAT_Q31
+// Ventana de muestras, ventana filtrada y RFFT en q31
+static q31_t fixed_input[FFT_LEN_MAX] __ALIGNED(8);
+static q31_t fixed_filtered[FFT_LEN_MAX] __ALIGNED(8);
+static q31_t fixed_spectrum[2 * FFT_LEN_MAX] __ALIGNED(8);
+#endif
+#if APP_FIR_FILTER
+// FIR de fase lineal y sus coeficientes (se vuelven a diseñar al cambiar fs)
+static fir_ols_t fir;
+static float32_t fir_coeffs[APP_FIR_TAPS];
+#endif
+#if APP_MAINS_CANCELLER
+// Cancelador de la red antes del filtro, uno por derivacion
+static mains_t mains[APP_LEADS];
+#endif
+// Estimador de Welch de la señal filtrada
+static psd_t psd;
+// Detector de QRS sobre la señal filtrada
+static qrs_t qrs;
+// Variabilidad de los latidos y muestras desde el ultimo resumen
+static hrv_t hrv;
+static uint32_t hrv_elapsed = 0;
+// Bloque filtrado en q31 (cadena IIR en punto fijo y entrada del detector de QRS)
+static q31_t fixed_chunk[SAMPLING_BLOCK_LEN] __ALIGNED(8);
+#if APP_LEADS > 1 && DSP_FORMAT != DSP_FORMAT_F32
+// Bloques de las demas derivaciones en q31
+static q31_t fixed_leads[APP_LEADS - 1][SAMPLING_BLOCK_LEN] __ALIGNED(8);
+#endif
+#if APP_PROTOCOL_BINARY
+// Host conectado en la ultima revision
+static bool host_connected = false;
+#else
+// Valores de frecuencia
+static float32_t freq_bins[FFT_LEN_MAX / 2] = {0};
+// Valores de tiempo
+static float32_t time_bins[FFT_LEN_MAX] = {0};
+#endif
 
 // Prototipos privados
-static bool adc_start_conversion(repeating_timer_t *t);
+#if APP_DUAL_CORE
+static void app_core1_entry(void);
+#endif
+static bool app_apply_config(float32_t fs, uint32_t fft_len);
+static void app_command(const protocol_rx_t *rx);
+static void app_filter_block(const q15_t *samples, app_result_t *result, uint32_t offset, app_chunk_t *chunk);
+static void app_process_block(app_result_t *result);
+static void app_spectrum(app_result_t *result, bool filtered);
+static void adc_dma_handler(void);
+static q15_t *sampling_buffer(uint32_t index);
 
 /**
  * @brief Inicializacion de perifericos
@@ -26,84 +119,689 @@ void app_init(void) {
     // Inicializacion de funciones DSP
     dsp_init();
 
-    // Configuro el canal 0 del ADC
+    // Configuro las entradas del ADC de cada derivacion, con varias las convierte por turno
     adc_init();
-    adc_gpio_init(ECG_ADC_GPIO);
+    for(uint32_t i = 0; i < APP_LEADS; i++) { adc_gpio_init(ECG_ADC_GPIO + i); }
     adc_select_input(ECG_ADC_CH);
+#if APP_LEADS > 1
+    adc_set_round_robin(((1u << APP_LEADS) - 1) << ECG_ADC_CH);
+#endif
+    // Cada conversion va al FIFO y pide DMA, sin bit de error ni corrimiento a 8 bits
+    adc_fifo_setup(true, true, 1, false, false);
+
+    // Reservo los dos canales antes de encadenarlos
+    dma_chan[0] = dma_claim_unused_channel(true);
+    dma_chan[1] = dma_claim_unused_channel(true);
+    // Configuro cada canal para copiar del FIFO del ADC a su buffer y disparar al otro al terminar
+    for(uint32_t i = 0; i < 2; i++) {
+        dma_channel_config dma_config = dma_channel_get_default_config(dma_chan[i]);
+        channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_16);
+        channel_config_set_read_increment(&dma_config, false);
+        channel_config_set_write_increment(&dma_config, true);
+        channel_config_set_dreq(&dma_config, DREQ_ADC);
+        channel_config_set_chain_to(&dma_config, dma_chan[1 - i]);
+        // El destino y la cantidad de transferencias los pone app_apply_config
+        dma_channel_configure(
+            dma_chan[i],                    // Canal de DMA
+            &dma_config,                    // Configuracion
+            adc_raw[i],                     // Destino
+            &adc_hw->fifo,                  // Origen
+            SAMPLING_BLOCK_LEN,             // Cantidad de transferencias
+            false                           // No arranca todavia
+        );
+        // Interrupcion al terminar cada bloque
+        dma_channel_set_irq0_enabled(dma_chan[i], true);
+    }
+    irq_set_exclusive_handler(DMA_IRQ_0, adc_dma_handler);
+    irq_set_enabled(DMA_IRQ_0, true);
+
+    // Configuracion de arranque (FS y FFT_LEN)
+    bool ok = app_apply_config(FS, FFT_LEN);
+    while(!ok);
 
-    // Inicializo timer
+#if APP_DUAL_CORE
+    // El nucleo 1 se encarga del DSP
+    multicore_launch_core1(app_core1_entry);
+#endif
+
+    // Arranco el sampling
     sampling_start();
 }
 
 /**
- * @brief Mando datos por USB
- * @param str cadena de texto con cadena
+ * @brief Filtra el proximo bloque lleno y procesa la ventana cuando se completa
+ * @return devuelve true si se proceso un bloque
+*/
+bool app_dsp_task(void) {
+#if APP_DUAL_CORE
+    // Mientras el nucleo 0 reconfigura no toco nada
+    if(dsp_pause_request) {
+        dsp_paused = true;
+        return false;
+    }
+#endif
+    // Necesito un bloque lleno, un bloque filtrado libre y, al empezar una ventana, un resultado libre
+    // (si falta algo el bloque espera en su buffer; solo este nucleo saca de esas colas, lo contado no se va)
+    if(!sampling_is_done() || spsc_queue_count(&chunk_free_queue) == 0) { return false; }
+    if(window_fill == 0 && spsc_queue_count(&result_free_queue) == 0) { return false; }
+    uint32_t chunk_index;
+    sampling_block_t block;
+    if(!spsc_queue_pop(&chunk_free_queue, &chunk_index) || !sampling_get_block(&block)) { return false; }
+    if(window_fill == 0 && !spsc_queue_pop(&result_free_queue, &window_index)) { return false; }
+    app_result_t *result = &results[window_index];
+    app_chunk_t *chunk = &chunks[chunk_index];
+    // Al empezar la ventana la PSD acumula en su resultado y usa de trabajo la RFFT sin normalizar,
+    // que no se llena hasta cerrar la ventana (2 * psd.len <= fft_len)
+    if(window_fill == 0) {
+        result->seq = block.seq;
+        psd_start(&psd, result->psd, result->rfft_output_raw);
+    }
+    // Filtro el bloque dentro de la ventana y libero el buffer
+    uint64_t start = profile_start();
+    app_filter_block(block.samples, result, window_fill, chunk);
+    profile_stop(PROFILE_FILTER, start);
+    sampling_release_block(&block);
+    // Los segmentos de Welch avanzan con cada bloque
+    start = profile_start();
+    psd_add(&psd, &result->filtered[window_fill], SAMPLING_BLOCK_LEN);
+    profile_stop(PROFILE_PSD, start);
+    // El detector de QRS corre muestra a muestra en q31 (en punto fijo el bloque ya esta en fixed_chunk)
+    start = profile_start();
+#if DSP_FORMAT == DSP_FORMAT_F32
+    dsp_volts_to_q31(&result->filtered[window_fill], fixed_chunk, DSP_FIXED_FULL_SCALE, SAMPLING_BLOCK_LEN);
+#endif
+    chunk->beat_count = qrs_process(&qrs, fixed_chunk, SAMPLING_BLOCK_LEN, block.seq * SAMPLING_BLOCK_LEN, chunk->beats, APP_CHUNK_BEATS);
+    profile_stop(PROFILE_QRS, start);
+    // Cada latido actualiza la variabilidad y una vez por segundo sale el resumen
+    start = profile_start();
+    for(uint32_t i = 0; i < chunk->beat_count; i++) { hrv_add_beat(&hrv, chunk->beats[i].sample, chunk->beats[i].offset); }
+    hrv_elapsed += SAMPLING_BLOCK_LEN;
+    chunk->hrv_ready = hrv_elapsed >= config.fs;
+    if(chunk->hrv_ready) {
+        hrv_get(&hrv, &chunk->hrv);
+        hrv_elapsed -= (uint32_t) config.fs;
+    }
+    profile_stop(PROFILE_HRV, start);
+    // Publico el bloque filtrado sin esperar a que se complete la ventana
+    chunk->seq = block.seq;
+    memcpy(chunk->filtered, &result->filtered[window_fill], sizeof(chunk->filtered));
+    spsc_queue_push(&chunk_ready_queue, chunk_index);
+    // Con la ventana completa calculo los espectros y publico el resultado
+    window_fill += SAMPLING_BLOCK_LEN;
+    if(window_fill == config.fft_len) {
+        app_process_block(result);
+        result->psd_bins = psd.len / 2;
+        result->psd_segments = psd_get(&psd);
+        spsc_queue_push(&result_ready_queue, window_index);
+        window_fill = 0;
+    }
+    return true;
+}
+
+/**
+ * @brief Manda por USB los bloques filtrados y el proximo resultado listo
+ * @return devuelve true si se mando algo
+*/
+bool app_send_task(void) {
+    // Atiendo los comandos del host antes de mandar nada
+    int c;
+    while((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
+        if(protocol_receive(&command_rx, c)) { app_command(&command_rx); }
+    }
+#if APP_PROTOCOL_BINARY
+    // Mando la configuracion cuando se conecta el host o si cambio
+    bool connected = stdio_usb_connected();
+    if(connected && (!host_connected || meta_pending)) { send_meta(); }
+    host_connected = connected;
+#endif
+    // Los bloques filtrados van primero, son los que tienen que llegar rapido
+    bool sent = false;
+    uint32_t index;
+    while(spsc_queue_pop(&chunk_ready_queue, &index)) {
+        app_chunk_t *chunk = &chunks[index];
+        uint64_t start = profile_start();
+#if APP_SEND_RAW
+#if APP_PROTOCOL_BINARY
+        protocol_send(STREAM_FILTERED, PROTOCOL_F32, chunk->seq, chunk->filtered, SAMPLING_BLOCK_LEN);
+#if APP_LEADS > 1
+        protocol_send(STREAM_LEADS, PROTOCOL_F32, chunk->seq, chunk->leads, (APP_LEADS - 1) * SAMPLING_BLOCK_LEN);
+#endif
+#else
+        send_data("filtered", chunk->filtered, SAMPLING_BLOCK_LEN);
+#if APP_LEADS > 1
+        send_data("leads", chunk->leads[0], (APP_LEADS - 1) * SAMPLING_BLOCK_LEN);
+#endif
+#endif
+#endif
+        profile_stop(PROFILE_SEND_FILTERED, start);
+        if(chunk->beat_count) { send_beats(chunk->seq, chunk->beats, chunk->beat_count); }
+        if(chunk->hrv_ready) { send_hrv(chunk->seq, &chunk->hrv); }
+        spsc_queue_push(&chunk_free_queue, index);
+        sent = true;
+    }
+    // Veo si hay un resultado listo
+    if(!spsc_queue_pop(&result_ready_queue, &index)) { return sent; }
+    app_result_t *result = &results[index];
+    uint64_t start = profile_start();
+#if APP_SEND_RAW && APP_PROTOCOL_BINARY
+    // Mando los resultados en tramas con el numero de bloque como secuencia (los ejes van en la metadata)
+    protocol_send(STREAM_IFFT_REAL, PROTOCOL_F32, result->seq, result->input, config.fft_len);
+    protocol_send(STREAM_FFT_REAL, PROTOCOL_F32, result->seq, result->rfft_output_normalized, config.fft_len / 2);
+    protocol_send(STREAM_FFT_FILTERED, PROTOCOL_F32, result->seq, result->rfft_filtered, config.fft_len / 2);
+    if(result->psd_segments) { protocol_send(STREAM_PSD, PROTOCOL_F32, result->seq, result->psd, result->psd_bins); }
+#elif APP_SEND_RAW
+    // Mando los resultados
+    send_data("freqs", freq_bins, config.fft_len / 2);
+    send_data("ifft_real", result->input, config.fft_len);
+    send_data("fft_real", result->rfft_output_normalized, config.fft_len / 2);
+    send_data("time", time_bins, config.fft_len);
+    send_data("fft_filtered", result->rfft_filtered, config.fft_len / 2);
+    if(result->psd_segments) { send_data("psd", result->psd, result->psd_bins); }
+#endif
+    // Mando los contadores de la adquisicion
+    send_stats(result->seq);
+    profile_stop(PROFILE_SEND_RESULT, start);
+    // Mando los tiempos de cada etapa una vez por ventana
+    send_profile(result->seq);
+    // Devuelvo el resultado al DSP
+    spsc_queue_push(&result_free_queue, index);
+    return true;
+}
+
+/**
+ * @brief Mando datos por USB como una linea de JSON
+ * @param label nombre del arreglo
  * @param data puntero a datos
  * @param len cantidad de muestras
 */
-void send_data(char *label, float32_t *data, uint32_t len) {
-    // Reservo memoria
-    char *str = (char*) malloc(12 * len + sizeof("{\"\":[]}\n") + sizeof(label));
-    // Inicio de cadena
-    sprintf(str, "{\"%s\":[", label);
-    // Agrego cada dato
+void send_data(const char *label, const float32_t *data, uint32_t len) {
+    // La linea se arma en un buffer fijo y sale por tramos cuando no entra el proximo valor
+    char str[SEND_DATA_BUFFER_LEN];
+    // Inicio de cadena (la etiqueta es corta, siempre entra)
+    uint32_t used = snprintf(str, sizeof(str), "{\"%s\":[", label);
+    // Agrego cada dato, con coma salvo el ultimo
     for(uint32_t i = 0; i < len; i++) {
-        char aux[10];
-        // Veo si es el ultimo
-        if(i < len - 1) {
-            sprintf(aux, "%f,", data[i]);
+        if(sizeof(str) - used < SEND_DATA_VALUE_LEN) {
+            printf("%s", str);
+            used = 0;
         }
-        else {
-            sprintf(aux, "%f", data[i]);
-        }
-        strcat(str, aux);
+        used += snprintf(&str[used], sizeof(str) - used, (i < len - 1)? "%f," : "%f", data[i]);
     }
+    // Cierre de la linea
+    if(sizeof(str) - used < sizeof("]}\n")) {
+        printf("%s", str);
+        used = 0;
+    }
+    snprintf(&str[used], sizeof(str) - used, "]}\n");
+    printf("%s", str);
+}
 
-    sprintf(str, "%s]}\n", str);
-    printf(str);
-    free(str);
+/**
+ * @brief Manda la configuracion de la sesion por USB
+*/
+void send_meta(void) {
+    // Armo la configuracion actual
+    const protocol_meta_t meta = {
+        .fs = config.fs,
+        .fft_len = config.fft_len,
+        .volts_per_count = ADC_VOLTS_PER_COUNT,
+        .notch_f0 = NOTCH_F0,
+        .bp_f1 = BP_F1,
+        .bp_f2 = BP_F2,
+        .leads = APP_LEADS,
+    };
+    protocol_send(STREAM_META, PROTOCOL_U8, 0, &meta, sizeof(meta));
+    meta_pending = false;
 }
 
 /**
- * @brief Inicializa el timer para arrancar el sampleo
+ * @brief Manda los contadores de la adquisicion por USB
+ * @param seq numero de bloque al que acompañan
 */
-void sampling_start(void) {
-    // Limpio el flag
-    sampling_done = false;
-    // Configuro un timer para asegurar la frecuencia de muestreo
-    add_repeating_timer_us(
-        (uint32_t)(1000000 * TS),       // Tiempo en microsegundos para el sampling rate
-        adc_start_conversion,           // Callback
-        NULL,                           // No hay user data
-        &timer                          // Puntero a timer
+void send_stats(uint32_t seq) {
+    // Copio los contadores
+    sampling_stats_t aux;
+    sampling_get_stats(&aux);
+#if APP_PROTOCOL_BINARY
+    // Muestras capturadas, bloques perdidos y bloques procesados
+    const uint32_t counters[] = { aux.blocks * SAMPLING_BLOCK_LEN, aux.dropped, aux.processed };
+    protocol_send(STREAM_STATS, PROTOCOL_U32, seq, counters, sizeof(counters) / sizeof(uint32_t));
+#else
+    // Muestras capturadas, bloques perdidos y bloques procesados
+    printf("{\"stats\":[%lu,%lu,%lu]}\n",
+        (unsigned long) aux.blocks * SAMPLING_BLOCK_LEN,
+        (unsigned long) aux.dropped,
+        (unsigned long) aux.processed
     );
+#endif
+}
+
+/**
+ * @brief Manda los latidos detectados por USB
+ * @param seq numero de bloque con el que se detectaron
+ * @param beats puntero a latidos
+ * @param count cantidad de latidos
+*/
+void send_beats(uint32_t seq, const qrs_beat_t *beats, uint32_t count) {
+#if APP_PROTOCOL_BINARY
+    // Muestra del pico, amplitud en volts y RR en muestras por latido
+    protocol_send(STREAM_BEATS, PROTOCOL_U8, seq, beats, count * sizeof(qrs_beat_t));
+#else
+    for(uint32_t i = 0; i < count; i++) {
+        printf("{\"beat\":[%lu,%f,%lu]}\n",
+            (unsigned long) beats[i].sample,
+            beats[i].amplitude,
+            (unsigned long) beats[i].rr
+        );
+    }
+#endif
+}
+
+/**
+ * @brief Manda el resumen de variabilidad por USB
+ * @param seq numero de bloque con el que se completo el segundo
+ * @param summary puntero al resumen
+*/
+void send_hrv(uint32_t seq, const hrv_summary_t *summary) {
+#if APP_PROTOCOL_BINARY
+    protocol_send(STREAM_HRV, PROTOCOL_F32, seq, summary, sizeof(hrv_summary_t) / sizeof(float));
+#else
+    send_data("hrv", (const float32_t*) summary, sizeof(hrv_summary_t) / sizeof(float));
+#endif
+}
+
+/**
+ * @brief Manda los tiempos de cada etapa por USB y arranca un periodo nuevo
+ * @param seq numero de bloque al que acompañan
+*/
+void send_profile(uint32_t seq) {
+    profile_report_t reports[PROFILE_STAGES];
+    profile_snapshot(reports);
+#if APP_PROTOCOL_BINARY
+    // Por etapa: mediciones, minimo, media, maximo y tiempo disponible en us
+    protocol_send(STREAM_PROFILE, PROTOCOL_U32, seq, reports, PROFILE_STAGES * sizeof(profile_report_t) / sizeof(uint32_t));
+#else
+    // Por etapa: mediciones, minimo, media, maximo y tiempo disponible en us
+    printf("{\"profile\":[");
+    for(uint32_t i = 0; i < PROFILE_STAGES; i++) {
+        printf("%s[%lu,%lu,%lu,%lu,%lu]", i? "," : "",
+            (unsigned long) reports[i].count,
+            (unsigned long) reports[i].min_us,
+            (unsigned long) reports[i].mean_us,
+            (unsigned long) reports[i].max_us,
+            (unsigned long) reports[i].budget_us
+        );
+    }
+    printf("]}\n");
+#endif
+}
+
+/**
+ * @brief Arranca la captura continua de bloques por DMA
+*/
+void sampling_start(void) {
+    // Descarto lo que haya quedado en el FIFO y vuelvo a la primera derivacion
+    adc_run(false);
+    adc_fifo_drain();
+    adc_select_input(ECG_ADC_CH);
+    // Disparo el primer canal (el segundo arranca encadenado) y largo el ADC
+    dma_channel_start(dma_chan[0]);
+    adc_run(true);
+}
+
+/**
+ * @brief Detiene el ADC y los dos canales de DMA (los bloques en vuelo se pierden)
+*/
+void sampling_stop(void) {
+    // Sin conversiones no hay pedidos de DMA
+    adc_run(false);
+    // Sin la interrupcion, el aborto no publica un bloque a medio llenar
+    irq_set_enabled(DMA_IRQ_0, false);
+    // Abortar un canal puede disparar al encadenado (RP2040-E13), asi que paso dos veces
+    for(uint32_t pass = 0; pass < 2; pass++) {
+        for(uint32_t i = 0; i < 2; i++) {
+            dma_channel_abort(dma_chan[i]);
+            dma_channel_acknowledge_irq0(dma_chan[i]);
+        }
+    }
+    irq_set_enabled(DMA_IRQ_0, true);
+    adc_fifo_drain();
+}
+
+/**
+ * @brief Cambia la frecuencia de muestreo y el largo de ventana sin reiniciar
+ * @param fs frecuencia de muestreo en Hz (FS_MIN a FS_MAX, hasta SAMPLING_FS_MAX con varias derivaciones)
+ * @param fft_len muestras por ventana (potencia de 2, FFT_LEN_MIN a FFT_LEN_MAX)
+ * @return devuelve false si la configuracion no es valida (sigue la anterior)
+*/
+bool app_configure(float32_t fs, uint32_t fft_len) {
+    // La configuracion vuelve al host aunque no cambie nada
+    meta_pending = true;
+    if(!(fs >= FS_MIN && fs <= FS_MAX && fs <= SAMPLING_FS_MAX)) { return false; }
+    if(fft_len < FFT_LEN_MIN || fft_len > FFT_LEN_MAX || (fft_len & (fft_len - 1))) { return false; }
+#if APP_DUAL_CORE
+    // Espero a que el nucleo 1 suelte los buffers
+    dsp_paused = false;
+    dsp_pause_request = true;
+    while(!dsp_paused) { tight_loop_contents(); }
+#endif
+    sampling_stop();
+    bool ok = app_apply_config(fs, fft_len);
+    // Si CMSIS rechaza el largo vuelvo a lo que habia
+    if(!ok) { app_apply_config(config.fs, config.fft_len); }
+#if APP_DUAL_CORE
+    dsp_pause_request = false;
+#endif
+    sampling_start();
+    return ok;
 }
 
 /**
- * @brief Verifica si se termino el sampling
- * @return devuelve true si se termino de muestrear
+ * @brief Verifica si hay bloques esperando ser procesados
+ * @return devuelve true si hay al menos un bloque lleno
 */
 bool sampling_is_done(void) {
-    return sampling_done;
+    return spsc_queue_count(&ready_queue) > 0;
+}
+
+/**
+ * @brief Toma el bloque lleno mas viejo
+ * @param block puntero a donde se describe el bloque
+ * @return devuelve false si no hay bloques llenos
+*/
+bool sampling_get_block(sampling_block_t *block) {
+    // Saco el proximo buffer lleno
+    if(!spsc_queue_pop(&ready_queue, &block->index)) { return false; }
+    block->samples = adc_samples[block->index][0];
+    block->seq = adc_seq[block->index];
+    return true;
+}
+
+/**
+ * @brief Devuelve el buffer de un bloque para que el DMA lo vuelva a usar
+ * @param block puntero al bloque tomado con sampling_get_block
+*/
+void sampling_release_block(sampling_block_t *block) {
+    // Nunca hay mas buffers que lugares en la cola
+    spsc_queue_push(&free_queue, block->index);
+    stats.processed++;
+}
+
+/**
+ * @brief Convierte muestras diezmadas a tension
+ * @param src puntero a muestras q15
+ * @param dst puntero a destino en volts
+ * @param len cantidad de muestras
+*/
+void sampling_to_volts(const q15_t *src, float32_t *dst, uint32_t len) {
+    // Escalo con una multiplicacion y una suma por muestra (la media escala vuelve a ser la del ADC)
+    for(uint32_t i = 0; i < len; i++) { dst[i] = ADC_MID_SCALE_VOLTS + (DSP_FIXED_FULL_SCALE / 32768.0f) * src[i]; }
 }
 
 /**
- * @brief Callback del timer para hacer una conversion con el ADC
- * @param t puntero a timer usado
+ * @brief Copia los contadores de la adquisicion
+ * @param dst puntero a destino de los contadores
 */
-static bool adc_start_conversion(repeating_timer_t *t) {
-    // Contador de conversiones
-    static uint32_t i = 0;
-    // Leo el ADC, calculo la tension y saco el offset
-    rfft_input[i++] = 3.3 * adc_read() / 4095;
-    // Si ya se tomaron todas las muestras
-    if(i == FFT_LEN) { 
-        // Reinicio el contador
-        i = 0; 
-        // Cancelo el timer
-        cancel_repeating_timer(t);
-        // Seteo flag
-        sampling_done = true;
+void sampling_get_stats(sampling_stats_t *dst) {
+    dst->blocks = stats.blocks;
+    dst->dropped = stats.dropped;
+    dst->processed = stats.processed;
+}
+
+/**
+ * @brief Aplica una configuracion con la adquisicion detenida
+ * @param fs frecuencia de muestreo en Hz
+ * @param fft_len muestras por ventana
+ * @return devuelve false si no se pudieron inicializar las RFFT
+*/
+static bool app_apply_config(float32_t fs, uint32_t fft_len) {
+    if(!dsp_set_len(fft_len)) { return false; }
+    // Los filtros se vuelven a diseñar para la nueva fs y arrancan de cero
+#if APP_MAINS_CANCELLER
+    // Con el cancelador la etapa del notch queda como paso directo (si fs es muy alta para el LMS queda el notch)
+    bool cancel = true;
+    for(uint32_t i = 0; i < APP_LEADS; i++) { cancel = mains_init(&mains[i], NOTCH_F0, fs); }
+    dsp_iir_init(BP_F1, BP_F2, cancel? 0.0f : NOTCH_F0, fs);
+#else
+    dsp_iir_init(BP_F1, BP_F2, NOTCH_F0, fs);
+#endif
+    // Segmentos de Welch mas cortos que la ventana, asi se promedian varios por ventana
+    uint32_t psd_len = fft_len / APP_PSD_DIVIDER;
+    if(psd_len < PSD_LEN_MIN) { psd_len = PSD_LEN_MIN; }
+    if(!psd_init(&psd, psd_len, APP_PSD_WINDOW, fs)) { return false; }
+    // El detector de QRS vuelve a aprender los umbrales
+    qrs_init(&qrs, fs, DSP_FIXED_FULL_SCALE);
+    hrv_init(&hrv, fs);
+    hrv_elapsed = 0;
+#if APP_FIR_FILTER
+    fir_design_band(fir_coeffs, APP_FIR_TAPS, BP_F1, BP_F2, NOTCH_F0, APP_FIR_NOTCH_BW, fs);
+    if(!fir_ols_init(&fir, fir_coeffs, APP_FIR_TAPS)) { return false; }
+#endif
+    config.fs = fs;
+    config.fft_len = fft_len;
+    // El ADC corre libre con un periodo de (1 + div) ciclos de su reloj, SAMPLING_OVERSAMPLE veces por muestra y derivacion
+    adc_set_clkdiv(ADC_CLK_HZ / (fs * SAMPLING_OVERSAMPLE * APP_LEADS) - 1);
+    // El FIR de diezmado corta en proporcion a fs y arranca con estado nulo
+    dsp_lowpass_q15(adc_decim_coeffs, SAMPLING_DECIM_TAPS, SAMPLING_DECIM_CUTOFF * fs, fs * SAMPLING_OVERSAMPLE);
+    for(uint32_t i = 0; i < APP_LEADS; i++) {
+        arm_fir_decimate_init_q15(&adc_decimator[i], SAMPLING_DECIM_TAPS, SAMPLING_OVERSAMPLE, adc_decim_coeffs, adc_decim_state[i], SAMPLING_BLOCK_LEN * SAMPLING_OVERSAMPLE);
     }
+
+    // Cada etapa tiene el periodo de lo que procesa (bloque de DMA o ventana)
+    const uint32_t block_us = SAMPLING_BLOCK_LEN * 1000000.0 / fs;
+    const uint32_t window_us = fft_len * 1000000.0 / fs;
+    profile_set_budget(PROFILE_DMA_IRQ, block_us);
+    profile_set_budget(PROFILE_FILTER, block_us);
+    profile_set_budget(PROFILE_SEND_FILTERED, block_us);
+    profile_set_budget(PROFILE_PSD, block_us);
+    profile_set_budget(PROFILE_QRS, block_us);
+    profile_set_budget(PROFILE_HRV, block_us);
+    profile_set_budget(PROFILE_DECIMATE, block_us);
+    profile_set_budget(PROFILE_SPECTRUM_INPUT, window_us);
+    profile_set_budget(PROFILE_SPECTRUM_FILTERED, window_us);
+    profile_set_budget(PROFILE_SEND_RESULT, window_us);
+#if !APP_PROTOCOL_BINARY
+    // Los ejes solo dependen de fs y fft_len
+    dsp_rfft_get_freq_bins(fs, fft_len / 2, freq_bins);
+    dsp_irfft_get_time_bins(fs, fft_len, time_bins);
+#endif
+
+    // Reparto el arena de cada resultado para el nuevo largo y todos arrancan libres
+    for(uint32_t i = 0; i < APP_RESULT_SLOTS; i++) {
+        float32_t *arena = result_arena[i];
+        results[i].input = arena;
+        results[i].rfft_output_raw = arena + fft_len;
+        results[i].rfft_output_normalized = arena + 2 * fft_len;
+        results[i].rfft_filtered = arena + 2 * fft_len + fft_len / 2;
+        results[i].filtered = arena + 3 * fft_len;
+        results[i].psd = arena + 4 * fft_len;
+    }
+    spsc_queue_init(&result_ready_queue);
+    spsc_queue_init(&result_free_queue);
+    for(uint32_t i = 0; i < APP_RESULT_SLOTS; i++) { spsc_queue_push(&result_free_queue, i); }
+    window_fill = 0;
+    spsc_queue_init(&chunk_ready_queue);
+    spsc_queue_init(&chunk_free_queue);
+    for(uint32_t i = 0; i < APP_CHUNK_SLOTS; i++) { spsc_queue_push(&chunk_free_queue, i); }
+
+    // Cada canal de DMA llena su buffer de conversiones y todos los bloques diezmados quedan libres
+    spsc_queue_init(&ready_queue);
+    spsc_queue_init(&free_queue);
+    for(uint32_t i = 0; i < SAMPLING_BUFFERS; i++) { spsc_queue_push(&free_queue, i); }
+    for(uint32_t i = 0; i < 2; i++) {
+        dma_channel_set_write_addr(dma_chan[i], adc_raw[i], false);
+        dma_channel_set_trans_count(dma_chan[i], SAMPLING_BLOCK_LEN * SAMPLING_OVERSAMPLE * APP_LEADS, false);
+    }
+    meta_pending = true;
     return true;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Atiende un comando del host
+ * @param rx puntero al receptor con la trama completa
+*/
+static void app_command(const protocol_rx_t *rx) {
+    if(rx->command == COMMAND_CONFIG && rx->size == sizeof(protocol_config_t)) {
+        protocol_config_t request;
+        memcpy(&request, rx->payload, sizeof(request));
+        app_configure(request.fs, request.fft_len);
+    }
+}
+
+#if APP_DUAL_CORE
+/**
+ * @brief Lazo del nucleo 1, solo corre el DSP
+*/
+static void app_core1_entry(void) {
+    while(true) { app_dsp_task(); }
+}
+#endif
+
+/**
+ * @brief Pasa un bloque de DMA por la cadena IIR
+ * @param samples puntero a muestras diezmadas (APP_LEADS bloques de SAMPLING_BLOCK_LEN muestras)
+ * @param result puntero a resultado de la ventana
+ * @param offset posicion del bloque dentro de la ventana
+ * @param chunk puntero al bloque filtrado (recibe las demas derivaciones)
+*/
+static void app_filter_block(const q15_t *samples, app_result_t *result, uint32_t offset, app_chunk_t *chunk) {
+    float32_t *input = &result->input[offset];
+    float32_t *filtered = &result->filtered[offset];
+    // Las muestras en volts se mandan en cualquier formato
+    sampling_to_volts(samples, input, SAMPLING_BLOCK_LEN);
+#if DSP_FORMAT == DSP_FORMAT_F32
+    // Bloque de cada derivacion, la primera sobre la ventana
+    float32_t *leads[APP_LEADS] = { filtered };
+#if APP_LEADS > 1
+    for(uint32_t i = 1; i < APP_LEADS; i++) { leads[i] = chunk->leads[i - 1]; }
+#endif
+    // La cadena filtra volts centrados en media escala como en punto fijo (las
+    // muestras q15 ya lo estan), asi el pasaaltos no arranca con un escalon de 1.65 V
+    for(uint32_t i = 0; i < APP_LEADS; i++) { dsp_q15_to_volts(&samples[i * SAMPLING_BLOCK_LEN], leads[i], DSP_FIXED_FULL_SCALE, SAMPLING_BLOCK_LEN); }
+#if APP_MAINS_CANCELLER
+    for(uint32_t i = 0; i < APP_LEADS; i++) { mains_cancel(&mains[i], leads[i], leads[i], SAMPLING_BLOCK_LEN); }
+#endif
+#if APP_FIR_FILTER
+    // El FIR es solo para la primera derivacion
+    fir_ols(&fir, filtered, filtered, SAMPLING_BLOCK_LEN);
+    dsp_iir_leads(&leads[1], APP_LEADS - 1, SAMPLING_BLOCK_LEN);
+#else
+    dsp_iir_leads(leads, APP_LEADS, SAMPLING_BLOCK_LEN);
+#endif
+#else
+    // Filtro en q31 en cualquier formato fijo, en q15 el pasaaltos de 0.5 Hz no entra en los coeficientes
+    q31_t *leads[APP_LEADS] = { fixed_chunk };
+#if APP_LEADS > 1
+    for(uint32_t i = 1; i < APP_LEADS; i++) { leads[i] = fixed_leads[i - 1]; }
+#endif
+    for(uint32_t i = 0; i < APP_LEADS; i++) {
+        arm_q15_to_q31(&samples[i * SAMPLING_BLOCK_LEN], leads[i], SAMPLING_BLOCK_LEN);
+#if APP_MAINS_CANCELLER
+        mains_cancel_q31(&mains[i], leads[i], leads[i], SAMPLING_BLOCK_LEN);
+#endif
+    }
+    dsp_iir_leads_q31(leads, APP_LEADS, SAMPLING_BLOCK_LEN);
+    dsp_q31_to_volts(fixed_chunk, filtered, DSP_FIXED_FULL_SCALE, SAMPLING_BLOCK_LEN);
+#if APP_LEADS > 1
+    for(uint32_t i = 1; i < APP_LEADS; i++) { dsp_q31_to_volts(leads[i], chunk->leads[i - 1], DSP_FIXED_FULL_SCALE, SAMPLING_BLOCK_LEN); }
+#endif
+    // Guardo la ventana en el formato de la RFFT
+#if DSP_FORMAT == DSP_FORMAT_Q15
+    memcpy(&fixed_input[offset], samples, SAMPLING_BLOCK_LEN * sizeof(q15_t));
+    arm_q31_to_q15(fixed_chunk, &fixed_filtered[offset], SAMPLING_BLOCK_LEN);
+#else
+    arm_q15_to_q31(samples, &fixed_input[offset], SAMPLING_BLOCK_LEN);
+    memcpy(&fixed_filtered[offset], fixed_chunk, sizeof(fixed_chunk));
+#endif
+#endif
+}
+
+/**
+ * @brief Espectros de una ventana completa
+ * @param result puntero a resultado con las muestras y la señal filtrada cargadas
+*/
+static void app_process_block(app_result_t *result) {
+    uint64_t start = profile_start();
+    app_spectrum(result, false);
+    profile_stop(PROFILE_SPECTRUM_INPUT, start);
+    start = profile_start();
+    app_spectrum(result, true);
+    profile_stop(PROFILE_SPECTRUM_FILTERED, start);
+}
+
+/**
+ * @brief Espectro normalizado de la entrada o de la señal filtrada
+ * @param result puntero a resultado de la ventana
+ * @param filtered true para la señal filtrada
+*/
+static void app_spectrum(app_result_t *result, bool filtered) {
+    float32_t *dst = filtered? result->rfft_filtered : result->rfft_output_normalized;
+#if DSP_FORMAT == DSP_FORMAT_Q15
+    // RFFT en q15 (destruye la ventana, que se vuelve a llenar)
+    dsp_rfft_q15(filtered? fixed_filtered : fixed_input, fixed_spectrum, config.fft_len);
+    dsp_rfft_normalize_q15(fixed_spectrum, dst, DSP_FIXED_FULL_SCALE, config.fft_len);
+#elif DSP_FORMAT == DSP_FORMAT_Q31
+    // RFFT en q31 (destruye la ventana, que se vuelve a llenar)
+    dsp_rfft_q31(filtered? fixed_filtered : fixed_input, fixed_spectrum, config.fft_len);
+    dsp_rfft_normalize_q31(fixed_spectrum, dst, DSP_FIXED_FULL_SCALE, config.fft_len);
+#else
+    // Resuelvo la RFFT y arreglo las magnitudes
+    dsp_rfft(filtered? result->filtered : result->input, result->rfft_output_raw, config.fft_len);
+    dsp_rfft_normalize(result->rfft_output_raw, dst, config.fft_len);
+#endif
+}
+
+/**
+ * @brief Obtiene la direccion de un buffer de muestras
+ * @param index indice del buffer (SAMPLING_BUFFERS es el de descarte)
+ * @return puntero al bloque de la primera derivacion (las demas le siguen)
+*/
+static q15_t *sampling_buffer(uint32_t index) {
+    return (index < SAMPLING_BUFFERS)? adc_samples[index][0] : adc_discard[0];
+}
+
+/**
+ * @brief Interrupcion del DMA al completar un bloque
+*/
+static void adc_dma_handler(void) {
+    uint64_t start = profile_start();
+    // Reviso los dos canales
+    for(uint32_t i = 0; i < 2; i++) {
+        // Veo si este canal termino
+        if(!(dma_hw->ints0 & (1u << dma_chan[i]))) { continue; }
+        // Limpio la interrupcion
+        dma_hw->ints0 = 1u << dma_chan[i];
+        // El otro canal ya arranco encadenado, este buffer no se escribe hasta que lo rearme
+        uint16_t *raw = adc_raw[i];
+        const uint32_t len = SAMPLING_BLOCK_LEN * SAMPLING_OVERSAMPLE;
+        // Diezmo en un bloque libre o en el de descarte si no hay (el FIR no pierde continuidad)
+        uint32_t done;
+        if(!spsc_queue_pop(&free_queue, &done)) { done = SAMPLING_BUFFERS; }
+        q15_t *dst = sampling_buffer(done);
+        uint64_t decimate_start = profile_start();
+        dsp_counts_to_q15(raw, (q15_t*) raw, len * APP_LEADS);
+        for(uint32_t lead = 0; lead < APP_LEADS; lead++) {
+#if APP_LEADS > 1
+            // Las conversiones de cada derivacion estan cada APP_LEADS
+            const q15_t *src = adc_lead;
+            for(uint32_t k = 0; k < len; k++) { adc_lead[k] = ((q15_t*) raw)[k * APP_LEADS + lead]; }
+#else
+            const q15_t *src = (q15_t*) raw;
+#endif
+            arm_fir_decimate_fast_q15(&adc_decimator[lead], src, &dst[lead * SAMPLING_BLOCK_LEN], len);
+        }
+        profile_stop(PROFILE_DECIMATE, decimate_start);
+        // Publico el bloque diezmado
+        if(done < SAMPLING_BUFFERS) {
+            adc_seq[done] = stats.blocks;
+            spsc_queue_push(&ready_queue, done);
+        }
+        else {
+            stats.dropped++;
+        }
+        stats.blocks++;
+        // Rearmo el canal al principio de su buffer
+        dma_channel_set_write_addr(dma_chan[i], raw, false);
+    }
+    profile_stop(PROFILE_DMA_IRQ, start);
+}
@@ -1,17 +1,38 @@
-#include <malloc.h>
+#include <string.h>
+
 #include "dsp.h"
+#include "fir.h"
+
+// Contexto del DSP
+static dsp_context_t dsp_ctx;
 
-// Instancia para la RFFT
-static arm_rfft_fast_instance_f32 rfft_instance;
+// Prototipos privados
+static float32_t *dsp_scratch_copy(float32_t *src, uint32_t len);
+static void dsp_biquad(uint32_t stage, double b0, double b1, double b2, double a0, double a1, double a2);
 
 /**
  * @brief Inicializa lo necesario para implementar la RFFT
 */
 void dsp_init(void) {
+    // Inicializa las RFFT con la ventana de arranque y verifico que se haya podido
+    bool ok = dsp_set_len(FFT_LEN);
+    while(!ok);
+}
+
+/**
+ * @brief Vuelve a inicializar las RFFT para otro largo de ventana
+ * @param len cantidad de muestras (potencia de 2 hasta DSP_SCRATCH_LEN)
+ * @return devuelve false si CMSIS no soporta el largo
+*/
+bool dsp_set_len(uint32_t len) {
+    if(len > DSP_SCRATCH_LEN) { return false; }
     // Inicializa la RFFT
-    arm_status status = arm_rfft_fast_init_f32(&rfft_instance, FFT_LEN);
-    // Verifico que se haya podido inicializar
-    while(status != ARM_MATH_SUCCESS);
+    if(arm_rfft_fast_init_f32(&dsp_ctx.rfft_instance, len) != ARM_MATH_SUCCESS) { return false; }
+    // Inicializa la RFFT y la IRFFT en punto fijo (con reordenamiento de bits)
+    if(arm_rfft_init_q15(&dsp_ctx.rfft_q15_instance, len, 0, 1) != ARM_MATH_SUCCESS) { return false; }
+    if(arm_rfft_init_q31(&dsp_ctx.rfft_q31_instance, len, 0, 1) != ARM_MATH_SUCCESS) { return false; }
+    if(arm_rfft_init_q31(&dsp_ctx.irfft_q31_instance, len, 1, 1) != ARM_MATH_SUCCESS) { return false; }
+    return true;
 }
 
 /**
@@ -21,14 +42,21 @@ void dsp_init(void) {
  * @param len cantidad de muestras
 */
 void dsp_rfft(float32_t *src, float32_t *dst, uint32_t len) {
-    // Reservo memoria para el origen de la RFFT
-    float32_t *src_cpy = (float32_t*) malloc(len * sizeof(float32_t));
-    // Copio los datos de src
-    memcpy(src_cpy, src, len * sizeof(float32_t));
+    // La RFFT destruye el origen, trabajo sobre una copia
+    float32_t *src_cpy = dsp_scratch_copy(src, len);
+    // Calculo la RFFT
+    arm_rfft_fast_f32(&dsp_ctx.rfft_instance, src_cpy, dst, 0);
+}
+
+/**
+ * @brief Funcion que resuelve la RFFT usando el origen como memoria de trabajo
+ * @param src puntero a muestras (se destruye)
+ * @param dst puntero a destino de RFFT
+ * @param len cantidad de muestras
+*/
+void dsp_rfft_inplace(float32_t *src, float32_t *dst, uint32_t len) {
     // Calculo la RFFT
-    arm_rfft_fast_f32(&rfft_instance, src_cpy, dst, 0);
-    // Libero la memoria
-    free(src_cpy);
+    arm_rfft_fast_f32(&dsp_ctx.rfft_instance, src, dst, 0);
 }
 
 /**
@@ -64,8 +92,8 @@ void dsp_bp_filter(float32_t *src, float32_t f1, float32_t f2, float32_t fs, uin
     f1_index = (f1_index < 5)? 0 : f1_index - 5;
     // Calculo el indice de la frecuencia superior y lo corto un poco despues
     uint32_t f2_index = f2 / (fs / len) + 5; 
-    // Recorro todo el array de origen
-    for(uint32_t i = 0; i < len; i++) { 
+    // Recorro los len / 2 bins complejos
+    for(uint32_t i = 0; i < len / 2; i++) { 
         // Veo si esta fuera de la banda
         if(i < f1_index || i > f2_index) {
             // Cero a la parte real y la imaginaria
@@ -77,53 +105,439 @@ void dsp_bp_filter(float32_t *src, float32_t f1, float32_t f2, float32_t fs, uin
 
 /**
  * @brief Normaliza la magnitud de la RFFT
- * @param src puntero a RFFT
+ * @param src puntero a RFFT (no se modifica)
  * @param dst puntero a RFFT normalizada
  * @param len cantidad de muestras
 */
 void dsp_rfft_normalize(float32_t *src, float32_t *dst, uint32_t len) {
-    // Copio el puntero original para no perderlo
-    float32_t *src_cpy = (float32_t*) malloc(len * sizeof(float32_t));
-    // Copio los datos de src
-    memcpy(src_cpy, src, len * sizeof(float32_t));
-    // Corrijo las magnitudes
-    arm_cmplx_mag_f32(src_cpy, dst, len / 2);
-    // Escalo la salida y saco las frecuencias
-    for(uint32_t i = 0; i < len / 2; i++) {  dst[i] /= (len / 4);  }
-    // Libero la memoria
-    free(src_cpy);
+    // Calculo las magnitudes (no escribe el origen, no hace falta copiarlo)
+    arm_cmplx_mag_f32(src, dst, len / 2);
+    // Escalo la salida multiplicando por la inversa de len / 4
+    arm_scale_f32(dst, 4.0f / len, dst, len / 2);
 }
 
 /**
- * @brief Funcion que resuelve la RFFT
- * @param src puntero a muestras
- * @param dst puntero a destino de RFFT
+ * @brief Funcion que resuelve la IRFFT
+ * @param src puntero a RFFT compleja
+ * @param dst puntero a destino de IRFFT
  * @param len cantidad de muestras
 */
 void dsp_irfft(float32_t *src, float32_t *dst, uint32_t len) {
-    // Reservo memoria para el origen de la RFFT
-    float32_t *src_cpy = (float32_t*) malloc(len * sizeof(float32_t));
-    // Copio los datos de src
-    memcpy(src_cpy, src, len * sizeof(float32_t));
-    // Calculo la RFFT
-    arm_rfft_fast_f32(&rfft_instance, src_cpy, dst, 1);
-    // Libero la memoria
-    free(src_cpy);
+    // La IRFFT destruye el origen, trabajo sobre una copia
+    float32_t *src_cpy = dsp_scratch_copy(src, len);
+    // Calculo la IRFFT
+    arm_rfft_fast_f32(&dsp_ctx.rfft_instance, src_cpy, dst, 1);
+}
+
+/**
+ * @brief Funcion que resuelve la IRFFT usando el origen como memoria de trabajo
+ * @param src puntero a RFFT compleja (se destruye)
+ * @param dst puntero a destino de IRFFT
+ * @param len cantidad de muestras
+*/
+void dsp_irfft_inplace(float32_t *src, float32_t *dst, uint32_t len) {
+    // Calculo la IRFFT
+    arm_rfft_fast_f32(&dsp_ctx.rfft_instance, src, dst, 1);
 }
 
 /**
  * @brief Normaliza la magnitud de la IRFFT
  * @param src puntero a IRFFT
- * @param dst puntero a IRFFT normalizada
+ * @param dst puntero a IRFFT normalizada (puede ser src)
  * @param len cantudad de muestras
 */
 void dsp_irfft_normalize(float32_t *src, float32_t *dst, uint32_t len) {
-    // Copio el puntero original para no perderlo
-    float32_t *src_cpy = (float32_t*) malloc(len * sizeof(float32_t));
-    // Copio los datos de src
-    memcpy(src_cpy, src, len * sizeof(float32_t));
-    // Escalo la salida y saco las frecuencias
-    for(uint32_t i = 0; i < len; i++) {  dst[i] /= (len);  }
-    // Libero la memoria
-    free(src_cpy);
-}
\ No newline at end of file
+    // Escalo la salida multiplicando por la inversa de len
+    arm_scale_f32(src, 1.0f / len, dst, len);
+}
+
+/**
+ * @brief Diseña e inicializa la cadena IIR (pasaaltos, pasabajos y notch)
+ * @param f_hp frecuencia de corte del pasaaltos
+ * @param f_lp frecuencia de corte del pasabajos
+ * @param f_notch frecuencia del notch (0 deja la etapa como paso directo)
+ * @param fs frecuencia de muestreo
+*/
+void dsp_iir_init(float32_t f_hp, float32_t f_lp, float32_t f_notch, float32_t fs) {
+    // Biquads de Butterworth de segundo orden (Q = 1 / sqrt(2)). El diseño va en double: a 10 kHz
+    // cos(w0) del pasaaltos queda a uno o dos ulp de 1.0 y diseñado en float32 el corte se corre un 6 %
+    const double q_butter = 0.70710678118654752;
+    // Pasaaltos
+    double w0 = 2.0 * PI * f_hp / fs;
+    double cw = cos(w0);
+    double alpha = sin(w0) / (2.0 * q_butter);
+    dsp_biquad(0, (1.0 + cw) / 2.0, -(1.0 + cw), (1.0 + cw) / 2.0, 1.0 + alpha, -2.0 * cw, 1.0 - alpha);
+    // Pasabajos
+    w0 = 2.0 * PI * f_lp / fs;
+    cw = cos(w0);
+    alpha = sin(w0) / (2.0 * q_butter);
+    dsp_biquad(1, (1.0 - cw) / 2.0, 1.0 - cw, (1.0 - cw) / 2.0, 1.0 + alpha, -2.0 * cw, 1.0 - alpha);
+    // Notch
+    if(f_notch > 0.0f) {
+        w0 = 2.0 * PI * f_notch / fs;
+        cw = cos(w0);
+        alpha = sin(w0) / (2.0 * DSP_NOTCH_Q);
+        dsp_biquad(2, 1.0, -2.0 * cw, 1.0, 1.0 + alpha, -2.0 * cw, 1.0 - alpha);
+    }
+    else {
+        dsp_biquad(2, 1.0, 0.0, 0.0, 1.0, 0.0, 0.0);
+    }
+    // Arranco todas las cadenas con estado nulo
+    arm_biquad_cascade_df2T_init_f32(&dsp_ctx.iir_instance, DSP_IIR_STAGES, dsp_ctx.iir_coeffs, dsp_ctx.iir_state);
+    for(uint32_t i = 0; i < DSP_IIR_LEADS_MAX / 2; i++) {
+        arm_biquad_cascade_stereo_df2T_init_f32(&dsp_ctx.iir_stereo_instance[i], DSP_IIR_STAGES, dsp_ctx.iir_coeffs, dsp_ctx.iir_stereo_state[i]);
+    }
+    for(uint32_t i = 0; i < DSP_IIR_LEADS_MAX; i++) {
+        arm_biquad_cas_df1_32x64_init_q31(&dsp_ctx.iir_q31_instance[i], DSP_IIR_STAGES, dsp_ctx.iir_q31_coeffs, dsp_ctx.iir_q31_state[i], DSP_IIR_Q31_SHIFT);
+    }
+}
+
+/**
+ * @brief Filtra un bloque con la cadena IIR (guarda el estado entre bloques)
+ * @param src puntero a muestras
+ * @param dst puntero a destino (puede ser el mismo que src)
+ * @param len cantidad de muestras
+*/
+void dsp_iir(const float32_t *src, float32_t *dst, uint32_t len) {
+    arm_biquad_cascade_df2T_f32(&dsp_ctx.iir_instance, src, dst, len);
+}
+
+/**
+ * @brief Filtra un bloque q31 con la cadena IIR (guarda el estado entre bloques)
+ * @param src puntero a muestras
+ * @param dst puntero a destino (puede ser el mismo que src)
+ * @param len cantidad de muestras
+*/
+void dsp_iir_q31(const q31_t *src, q31_t *dst, uint32_t len) {
+    arm_biquad_cas_df1_32x64_q31(&dsp_ctx.iir_q31_instance[0], src, dst, len);
+}
+
+/**
+ * @brief Filtra en el lugar un bloque de cada derivacion con la cadena IIR (guarda el estado entre bloques)
+ * @param leads punteros a las muestras de cada derivacion
+ * @param count cantidad de derivaciones (hasta DSP_IIR_LEADS_MAX, si es impar la ultima usa el estado de dsp_iir)
+ * @param len cantidad de muestras por derivacion
+*/
+void dsp_iir_leads(float32_t *const *leads, uint32_t count, uint32_t len) {
+    for(uint32_t pair = 0; pair < count / 2; pair++) {
+        float32_t *a = leads[2 * pair];
+        float32_t *b = leads[2 * pair + 1];
+        // La biquad estereo recorre las dos señales intercaladas, las armo en scratch por tramos
+        for(uint32_t done = 0; done < len; done += DSP_SCRATCH_LEN / 2) {
+            const uint32_t n = (len - done < DSP_SCRATCH_LEN / 2)? len - done : DSP_SCRATCH_LEN / 2;
+            for(uint32_t i = 0; i < n; i++) {
+                dsp_ctx.scratch[2 * i] = a[done + i];
+                dsp_ctx.scratch[2 * i + 1] = b[done + i];
+            }
+            arm_biquad_cascade_stereo_df2T_f32(&dsp_ctx.iir_stereo_instance[pair], dsp_ctx.scratch, dsp_ctx.scratch, n);
+            for(uint32_t i = 0; i < n; i++) {
+                a[done + i] = dsp_ctx.scratch[2 * i];
+                b[done + i] = dsp_ctx.scratch[2 * i + 1];
+            }
+        }
+    }
+    if(count % 2) { dsp_iir(leads[count - 1], leads[count - 1], len); }
+}
+
+/**
+ * @brief Filtra en el lugar un bloque q31 de cada derivacion con la cadena IIR (guarda el estado entre bloques)
+ * @param leads punteros a las muestras de cada derivacion
+ * @param count cantidad de derivaciones (hasta DSP_IIR_LEADS_MAX, la primera usa el estado de dsp_iir_q31)
+ * @param len cantidad de muestras por derivacion
+*/
+void dsp_iir_leads_q31(q31_t *const *leads, uint32_t count, uint32_t len) {
+    for(uint32_t i = 0; i < count; i++) { arm_biquad_cas_df1_32x64_q31(&dsp_ctx.iir_q31_instance[i], leads[i], leads[i], len); }
+}
+
+/**
+ * @brief Pasa muestras q15 a volts
+ * @param src puntero a muestras q15
+ * @param dst puntero a destino en volts
+ * @param full_scale volts que representa 1.0
+ * @param len cantidad de muestras
+*/
+void dsp_q15_to_volts(const q15_t *src, float32_t *dst, float32_t full_scale, uint32_t len) {
+    arm_q15_to_float(src, dst, len);
+    arm_scale_f32(dst, full_scale, dst, len);
+}
+
+/**
+ * @brief Pasa muestras q31 a volts
+ * @param src puntero a muestras q31
+ * @param dst puntero a destino en volts
+ * @param full_scale volts que representa 1.0
+ * @param len cantidad de muestras
+*/
+void dsp_q31_to_volts(const q31_t *src, float32_t *dst, float32_t full_scale, uint32_t len) {
+    arm_q31_to_float(src, dst, len);
+    arm_scale_f32(dst, full_scale, dst, len);
+}
+
+/**
+ * @brief Pasa muestras en volts a q31 (satura fuera de la escala)
+ * @param src puntero a muestras en volts
+ * @param dst puntero a destino q31
+ * @param full_scale volts que representa 1.0
+ * @param len cantidad de muestras
+*/
+void dsp_volts_to_q31(const float32_t *src, q31_t *dst, float32_t full_scale, uint32_t len) {
+    const float32_t scale = 2147483648.0f / full_scale;
+    for(uint32_t i = 0; i < len; i++) {
+        const float32_t value = src[i] * scale;
+        if(value >= 2147483647.0f) { dst[i] = INT32_MAX; }
+        else if(value <= -2147483648.0f) { dst[i] = INT32_MIN; }
+        else { dst[i] = (q31_t) value; }
+    }
+}
+
+/**
+ * @brief Relacion señal a ruido de una señal contra una referencia
+ * @param ref puntero a referencia
+ * @param test puntero a señal a comparar
+ * @param len cantidad de muestras
+ * @return SNR en dB
+*/
+float32_t dsp_snr_db(const float32_t *ref, const float32_t *test, uint32_t len) {
+    // Acumulo la energia de la referencia y la del error
+    float32_t signal = 0.0f;
+    float32_t noise = 0.0f;
+    for(uint32_t i = 0; i < len; i++) {
+        float32_t error = ref[i] - test[i];
+        signal += ref[i] * ref[i];
+        noise += error * error;
+    }
+    return 10.0f * log10f(signal / noise);
+}
+
+/**
+ * @brief Convierte cuentas del ADC a q15 centradas en media escala (1.0 son 2048 cuentas)
+ * @param src puntero a cuentas
+ * @param dst puntero a destino q15
+ * @param len cantidad de muestras
+*/
+void dsp_counts_to_q15(const uint16_t *src, q15_t *dst, uint32_t len) {
+    // Resto media escala y alineo los 12 bits a la izquierda
+    for(uint32_t i = 0; i < len; i++) { dst[i] = (q15_t) (((int32_t) (src[i] & 0x0FFF) - 2048) * 16); }
+}
+
+/**
+ * @brief Diseña un pasabajos de fase lineal en q15 con ganancia 1 en continua (sinc con ventana de Hamming)
+ * @param coeffs puntero a destino de los coeficientes
+ * @param taps cantidad de coeficientes (hasta DSP_SCRATCH_LEN)
+ * @param fc frecuencia de corte
+ * @param fs frecuencia de muestreo
+*/
+void dsp_lowpass_q15(q15_t *coeffs, uint32_t taps, float32_t fc, float32_t fs) {
+    // El diseño es el de fir.c, en float sobre la memoria de trabajo y despues cuantizo
+    float32_t *h = dsp_ctx.scratch;
+    memset(h, 0, taps * sizeof(float32_t));
+    fir_add_lowpass(h, taps, fc, fs, 1.0f);
+    for(uint32_t i = 0; i < taps; i++) { coeffs[i] = clip_q31_to_q15((q31_t) lroundf(h[i] * 32768.0f)); }
+}
+
+/**
+ * @brief Funcion que resuelve la RFFT en q15
+ * @param src puntero a muestras (se destruye)
+ * @param dst puntero a destino de RFFT (2 * len valores, X[k] / len)
+ * @param len cantidad de muestras
+*/
+void dsp_rfft_q15(q15_t *src, q15_t *dst, uint32_t len) {
+    arm_rfft_q15(&dsp_ctx.rfft_q15_instance, src, dst);
+}
+
+/**
+ * @brief Funcion que aplica un filtro notch (sobre la RFFT q15)
+ * @param src puntero de muestras complejas
+ * @param f0 frecuencia de resonancia del filtro
+ * @param fs frecuencia de muestreo
+ * @param len cantidad de muestras
+*/
+void dsp_notch_filter_q15(q15_t *src, float32_t f0, float32_t fs, uint32_t len) {
+    // Calculo el indice de la frecuencia del filtro
+    uint32_t f0_index = f0 / (fs / len);
+    // Cero a la parte real y la imaginaria alrededor de f0
+    for(uint32_t i = f0_index - 5; i < f0_index + 5; i++) { 
+        src[2 * i] = 0;
+        src[2 * i + 1] = 0;
+    }
+}
+
+/**
+ * @brief Funcion que aplica un filtro pasabanda (sobre la RFFT q15)
+ * @param src puntero de muestras complejas
+ * @param f1 frecuencia de corte inferior
+ * @param f2 frecuencia de corte superior
+ * @param fs frecuencia de muestreo
+ * @param len cantidad de muestras
+*/
+void dsp_bp_filter_q15(q15_t *src, float32_t f1, float32_t f2, float32_t fs, uint32_t len) {
+    // Mismos indices que en float32
+    uint32_t f1_index = f1 / (fs / len);
+    f1_index = (f1_index < 5)? 0 : f1_index - 5;
+    uint32_t f2_index = f2 / (fs / len) + 5; 
+    // Recorro hasta Nyquist, que en punto fijo tiene su propio bin
+    for(uint32_t i = 0; i <= len / 2; i++) { 
+        if(i < f1_index || i > f2_index) {
+            src[2 * i] = 0;
+            src[2 * i + 1] = 0;
+        }
+    }
+}
+
+/**
+ * @brief Normaliza la magnitud de la RFFT q15 y la pasa a volts
+ * @param src puntero a RFFT q15
+ * @param dst puntero a RFFT normalizada en float
+ * @param full_scale volts que representa 1.0 en la entrada
+ * @param len cantidad de muestras
+*/
+void dsp_rfft_normalize_q15(const q15_t *src, float32_t *dst, float32_t full_scale, uint32_t len) {
+    // La magnitud sale en 2.14 y la uso como |X[k]| / len
+    q15_t *mag = dsp_ctx.scratch_q15;
+    arm_cmplx_mag_q15(src, mag, len / 2);
+    arm_q15_to_float(mag, dst, len / 2);
+    // Deshago el 2.14 (x2) y aplico la misma escala 4 / len que en float32
+    arm_scale_f32(dst, 2.0f * 4.0f * full_scale, dst, len / 2);
+}
+
+/**
+ * @brief Funcion que resuelve la IRFFT de un espectro q15 y la pasa a volts
+ * @param src puntero a RFFT q15 (se leen len + 2 valores)
+ * @param dst puntero a destino de IRFFT en float
+ * @param full_scale volts que representa 1.0 en la entrada
+ * @param len cantidad de muestras
+*/
+void dsp_irfft_q15(const q15_t *src, float32_t *dst, float32_t full_scale, uint32_t len) {
+    // Paso el espectro a q31 para no perder bits en la antitransformada
+    arm_q15_to_q31(src, dsp_ctx.scratch_q31, len + 2);
+    dsp_irfft_q31(dsp_ctx.scratch_q31, dst, full_scale, len);
+}
+
+/**
+ * @brief Convierte cuentas del ADC a q31 centradas en media escala (1.0 son 2048 cuentas)
+ * @param src puntero a cuentas
+ * @param dst puntero a destino q31
+ * @param len cantidad de muestras
+*/
+void dsp_counts_to_q31(const uint16_t *src, q31_t *dst, uint32_t len) {
+    // Resto media escala y alineo los 12 bits a la izquierda
+    for(uint32_t i = 0; i < len; i++) { dst[i] = (q31_t) (((int32_t) (src[i] & 0x0FFF) - 2048) * 1048576); }
+}
+
+/**
+ * @brief Funcion que resuelve la RFFT en q31
+ * @param src puntero a muestras (se destruye)
+ * @param dst puntero a destino de RFFT (2 * len valores, X[k] / len)
+ * @param len cantidad de muestras
+*/
+void dsp_rfft_q31(q31_t *src, q31_t *dst, uint32_t len) {
+    arm_rfft_q31(&dsp_ctx.rfft_q31_instance, src, dst);
+}
+
+/**
+ * @brief Funcion que aplica un filtro notch (sobre la RFFT q31)
+ * @param src puntero de muestras complejas
+ * @param f0 frecuencia de resonancia del filtro
+ * @param fs frecuencia de muestreo
+ * @param len cantidad de muestras
+*/
+void dsp_notch_filter_q31(q31_t *src, float32_t f0, float32_t fs, uint32_t len) {
+    // Calculo el indice de la frecuencia del filtro
+    uint32_t f0_index = f0 / (fs / len);
+    // Cero a la parte real y la imaginaria alrededor de f0
+    for(uint32_t i = f0_index - 5; i < f0_index + 5; i++) { 
+        src[2 * i] = 0;
+        src[2 * i + 1] = 0;
+    }
+}
+
+/**
+ * @brief Funcion que aplica un filtro pasabanda (sobre la RFFT q31)
+ * @param src puntero de muestras complejas
+ * @param f1 frecuencia de corte inferior
+ * @param f2 frecuencia de corte superior
+ * @param fs frecuencia de muestreo
+ * @param len cantidad de muestras
+*/
+void dsp_bp_filter_q31(q31_t *src, float32_t f1, float32_t f2, float32_t fs, uint32_t len) {
+    // Mismos indices que en float32
+    uint32_t f1_index = f1 / (fs / len);
+    f1_index = (f1_index < 5)? 0 : f1_index - 5;
+    uint32_t f2_index = f2 / (fs / len) + 5; 
+    // Recorro hasta Nyquist, que en punto fijo tiene su propio bin
+    for(uint32_t i = 0; i <= len / 2; i++) { 
+        if(i < f1_index || i > f2_index) {
+            src[2 * i] = 0;
+            src[2 * i + 1] = 0;
+        }
+    }
+}
+
+/**
+ * @brief Normaliza la magnitud de la RFFT q31 y la pasa a volts
+ * @param src puntero a RFFT q31
+ * @param dst puntero a RFFT normalizada en float
+ * @param full_scale volts que representa 1.0 en la entrada
+ * @param len cantidad de muestras
+*/
+void dsp_rfft_normalize_q31(const q31_t *src, float32_t *dst, float32_t full_scale, uint32_t len) {
+    // La magnitud sale en 2.30 y la uso como |X[k]| / len
+    q31_t *mag = dsp_ctx.scratch_q31;
+    arm_cmplx_mag_q31(src, mag, len / 2);
+    arm_q31_to_float(mag, dst, len / 2);
+    // Deshago el 2.30 (x2) y aplico la misma escala 4 / len que en float32
+    arm_scale_f32(dst, 2.0f * 4.0f * full_scale, dst, len / 2);
+}
+
+/**
+ * @brief Funcion que resuelve la IRFFT en q31 y la pasa a volts
+ * @param src puntero a RFFT q31 (se leen len + 2 valores y se destruye)
+ * @param dst puntero a destino de IRFFT en float
+ * @param full_scale volts que representa 1.0 en la entrada
+ * @param len cantidad de muestras
+*/
+void dsp_irfft_q31(q31_t *src, float32_t *dst, float32_t full_scale, uint32_t len) {
+    // La salida queda en x[n] / len, uso dst como memoria q31 (mismo tamaño)
+    q31_t *out = (q31_t*) dst;
+    arm_rfft_q31(&dsp_ctx.irfft_q31_instance, src, out);
+    // Paso a float en el lugar y deshago la escala
+    for(uint32_t i = 0; i < len; i++) { dst[i] = (float32_t) out[i]; }
+    arm_scale_f32(dst, full_scale * len / 2147483648.0f, dst, len);
+}
+
+/**
+ * @brief Copia el origen a la memoria de trabajo
+ * @param src puntero a muestras
+ * @param len cantidad de muestras (hasta DSP_SCRATCH_LEN, dsp_set_len no acepta mas)
+ * @return puntero a la copia
+*/
+static float32_t *dsp_scratch_copy(float32_t *src, uint32_t len) {
+    memcpy(dsp_ctx.scratch, src, len * sizeof(float32_t));
+    return dsp_ctx.scratch;
+}
+
+/**
+ * @brief Carga una biquad normalizada con la convencion de CMSIS en float32 y en q31
+ * @param stage etapa de la cadena IIR
+ * @param b0 coeficiente b0
+ * @param b1 coeficiente b1
+ * @param b2 coeficiente b2
+ * @param a0 coeficiente a0
+ * @param a1 coeficiente a1
+ * @param a2 coeficiente a2
+*/
+static void dsp_biquad(uint32_t stage, double b0, double b1, double b2, double a0, double a1, double a2) {
+    // CMSIS suma los terminos de realimentacion, van con el signo cambiado
+    const double coeffs[5] = { b0 / a0, b1 / a0, b2 / a0, -a1 / a0, -a2 / a0 };
+    // Cada formato se redondea una sola vez desde double (q31 escalado por el corrimiento de salida)
+    const double scale = 2147483648.0 / (1 << DSP_IIR_Q31_SHIFT);
+    q31_t *fixed = &dsp_ctx.iir_q31_coeffs[5 * stage];
+    for(uint32_t i = 0; i < 5; i++) {
+        dsp_ctx.iir_coeffs[5 * stage + i] = (float32_t) coeffs[i];
+        fixed[i] = (q31_t) lround(coeffs[i] * scale);
+    }
+    // En q31 b1 y a1 se redondean para que las sumas en z = 1 queden exactas: con los polos del
+    // pasaaltos a 10 kHz 1 - a1 - a2 mide ~ 50 LSB y medio LSB de cada lado corre el corte un 2 %
+    fixed[1] = (q31_t) (lround((coeffs[0] + coeffs[1] + coeffs[2]) * scale) - fixed[0] - fixed[2]);
+    fixed[3] = (q31_t) (lround((coeffs[3] + coeffs[4]) * scale) - fixed[4]);
+}
@@ -0,0 +1,129 @@
+#include <string.h>
+
+#include "fir.h"
+
+// Prototipos privados
+static void fir_block(fir_ols_t *fir);
+
+/**
+ * @brief Prepara un filtro overlap-save y calcula su respuesta en frecuencia
+ * @param fir puntero al estado del filtro
+ * @param coeffs coeficientes del FIR
+ * @param taps cantidad de coeficientes (hasta FIR_OLS_TAPS_MAX)
+ * @return devuelve false si taps no entra en el bloque
+*/
+bool fir_ols_init(fir_ols_t *fir, const float32_t *coeffs, uint32_t taps) {
+    if(taps == 0 || taps > FIR_OLS_TAPS_MAX) { return false; }
+    if(arm_rfft_fast_init_f32(&fir->rfft_instance, FIR_OLS_FFT_LEN) != ARM_MATH_SUCCESS) { return false; }
+    fir->taps = taps;
+    fir->hop = FIR_OLS_FFT_LEN - taps + 1;
+    fir->fill = 0;
+    // Respuesta en frecuencia de los coeficientes completados con ceros
+    memset(fir->block, 0, sizeof(fir->block));
+    memcpy(fir->block, coeffs, taps * sizeof(float32_t));
+    arm_rfft_fast_f32(&fir->rfft_instance, fir->block, fir->response, 0);
+    // Arranco con historia y salida nulas
+    memset(fir->history, 0, sizeof(fir->history));
+    memset(fir->block, 0, sizeof(fir->block));
+    return true;
+}
+
+/**
+ * @brief Filtra un tramo de una señal continua (guarda el estado entre llamadas)
+ * @param fir puntero al estado del filtro
+ * @param src puntero a muestras
+ * @param dst puntero a destino (hop muestras atrasado, puede ser el mismo que src)
+ * @param len cantidad de muestras
+*/
+void fir_ols(fir_ols_t *fir, const float32_t *src, float32_t *dst, uint32_t len) {
+    while(len > 0) {
+        // Lo que falta para completar el bloque
+        uint32_t n = fir->hop - fir->fill;
+        if(n > len) { n = len; }
+        // Cambio muestras nuevas por salidas del bloque anterior (src y dst pueden ser el mismo)
+        memcpy(&fir->history[fir->taps - 1 + fir->fill], src, n * sizeof(float32_t));
+        memcpy(dst, &fir->block[fir->taps - 1 + fir->fill], n * sizeof(float32_t));
+        fir->fill += n;
+        src += n;
+        dst += n;
+        len -= n;
+        if(fir->fill == fir->hop) {
+            fir_block(fir);
+            fir->fill = 0;
+        }
+    }
+}
+
+/**
+ * @brief Diseña un pasabanda de fase lineal con un rechazabanda opcional (sinc con ventana de Hamming)
+ * @param coeffs puntero a destino de los coeficientes
+ * @param taps cantidad de coeficientes (impar para que el retardo sea entero)
+ * @param f_hp frecuencia de corte inferior
+ * @param f_lp frecuencia de corte superior
+ * @param f_notch frecuencia central del rechazabanda (solo si cae dentro de la banda de paso)
+ * @param notch_bw ancho total del rechazabanda
+ * @param fs frecuencia de muestreo
+*/
+void fir_design_band(float32_t *coeffs, uint32_t taps, float32_t f_hp, float32_t f_lp, float32_t f_notch, float32_t notch_bw, float32_t fs) {
+    memset(coeffs, 0, taps * sizeof(float32_t));
+    // La banda de paso es la resta de dos pasabajos con ganancia 1 en continua,
+    // asi la continua queda en cero exacto aunque la transicion sea ancha
+    fir_add_lowpass(coeffs, taps, f_lp, fs, 1.0f);
+    fir_add_lowpass(coeffs, taps, f_hp, fs, -1.0f);
+    // El rechazabanda se resta solo en la parte que cae dentro de la banda de paso
+    float32_t lo = f_notch - notch_bw / 2;
+    float32_t hi = f_notch + notch_bw / 2;
+    if(lo < f_hp) { lo = f_hp; }
+    if(hi > f_lp) { hi = f_lp; }
+    if(lo < hi) {
+        fir_add_lowpass(coeffs, taps, hi, fs, -1.0f);
+        fir_add_lowpass(coeffs, taps, lo, fs, 1.0f);
+    }
+}
+
+/**
+ * @brief Suma un pasabajos de fase lineal con ganancia en continua normalizada (sinc con ventana de Hamming)
+ * @param coeffs puntero a los coeficientes
+ * @param taps cantidad de coeficientes
+ * @param fc frecuencia de corte
+ * @param fs frecuencia de muestreo
+ * @param gain ganancia en continua
+*/
+void fir_add_lowpass(float32_t *coeffs, uint32_t taps, float32_t fc, float32_t fs, float32_t gain) {
+    // Sin banda de paso no hay nada que sumar
+    if(fc <= 0.0f) { return; }
+    const float32_t center = (taps - 1) / 2.0f;
+    const float32_t wc = 2.0f * PI * fc / fs;
+    float32_t sum = 0.0f;
+    // Primera pasada para la ganancia en continua, segunda para sumar
+    for(uint32_t pass = 0; pass < 2; pass++) {
+        for(uint32_t i = 0; i < taps; i++) {
+            const float32_t x = i - center;
+            const float32_t sinc = (x == 0.0f)? wc / PI : sinf(wc * x) / (PI * x);
+            const float32_t window = (taps > 1)? 0.54f - 0.46f * cosf(2.0f * PI * i / (taps - 1)) : 1.0f;
+            if(pass == 0) { sum += sinc * window; }
+            else { coeffs[i] += gain * sinc * window / sum; }
+        }
+    }
+}
+
+/**
+ * @brief Filtra el bloque completo y deja la historia para el proximo
+ * @param fir puntero al estado del filtro
+*/
+static void fir_block(fir_ols_t *fir) {
+    const uint32_t len = FIR_OLS_FFT_LEN;
+    // La RFFT destruye la entrada, transformo una copia de la historia
+    memcpy(fir->block, fir->history, sizeof(fir->block));
+    arm_rfft_fast_f32(&fir->rfft_instance, fir->block, fir->spectrum, 0);
+    // Continua y Nyquist son reales y van empaquetados en los dos primeros valores
+    const float32_t dc = fir->spectrum[0] * fir->response[0];
+    const float32_t nyquist = fir->spectrum[1] * fir->response[1];
+    arm_cmplx_mult_cmplx_f32(&fir->spectrum[2], &fir->response[2], &fir->spectrum[2], len / 2 - 1);
+    fir->spectrum[0] = dc;
+    fir->spectrum[1] = nyquist;
+    // La IRFFT de CMSIS ya divide por len
+    arm_rfft_fast_f32(&fir->rfft_instance, fir->spectrum, fir->block, 1);
+    // Las ultimas taps - 1 muestras son el principio del proximo bloque
+    memmove(fir->history, &fir->history[fir->hop], (fir->taps - 1) * sizeof(float32_t));
+}
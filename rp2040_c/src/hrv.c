@@ -0,0 +1,231 @@
+#include <string.h>
+
+#include "hrv.h"
+
+// Prototipos privados
+static void hrv_push_interval(hrv_t *hrv, int32_t rr_us);
+static void hrv_pop_interval(hrv_t *hrv);
+static void hrv_restart(hrv_t *hrv);
+static void hrv_resample(hrv_t *hrv, int32_t rr_us);
+static void hrv_band_init(hrv_band_t *band, float32_t f_hp, float32_t f_lp);
+static void hrv_band_add(hrv_band_t *band, float32_t value, uint32_t index);
+static void hrv_biquad(float32_t *coeffs, float32_t fc, float32_t fs, float32_t q, bool highpass);
+
+/**
+ * @brief Inicializa la variabilidad con la ventana vacia
+ * @param hrv puntero al estado
+ * @param fs frecuencia de muestreo de los latidos
+*/
+void hrv_init(hrv_t *hrv, float32_t fs) {
+    memset(hrv, 0, sizeof(hrv_t));
+    hrv->fs = fs;
+    hrv_band_init(&hrv->lf, HRV_LF_LOW, HRV_LF_HIGH);
+    hrv_band_init(&hrv->hf, HRV_HF_LOW, HRV_HF_HIGH);
+}
+
+/**
+ * @brief Agrega un latido y actualiza la ventana
+ * @param hrv puntero al estado
+ * @param sample muestra del pico R
+ * @param offset fraccion de muestra del pico R
+*/
+void hrv_add_beat(hrv_t *hrv, uint32_t sample, float32_t offset) {
+    if(!hrv->has_beat) {
+        hrv->has_beat = true;
+        hrv->last_sample = sample;
+        hrv->last_offset = offset;
+        return;
+    }
+    // Intervalo con la fraccion de cada pico (la resta entera no pierde precision)
+    const float32_t samples = (float32_t) (sample - hrv->last_sample) + (offset - hrv->last_offset);
+    hrv->last_sample = sample;
+    hrv->last_offset = offset;
+    // Un latido perdido o falso deja un RR fuera de rango que no entra en la ventana (se
+    // descarta antes de pasarlo a us, un hueco largo no entra en int32_t)
+    if(samples < HRV_RR_MIN_MS * 1e-3f * hrv->fs || samples > HRV_RR_MAX_MS * 1e-3f * hrv->fs) {
+        hrv_restart(hrv);
+        return;
+    }
+    const int32_t rr_us = (int32_t) (samples * 1e6f / hrv->fs + 0.5f);
+    hrv_resample(hrv, rr_us);
+    hrv_push_interval(hrv, rr_us);
+    hrv->last_rr_us = rr_us;
+}
+
+/**
+ * @brief Calcula el resumen de la ventana actual
+ * @param hrv puntero al estado
+ * @param dst puntero a destino (todo en cero si no hay intervalos)
+*/
+void hrv_get(const hrv_t *hrv, hrv_summary_t *dst) {
+    memset(dst, 0, sizeof(hrv_summary_t));
+    const uint32_t n = hrv->head - hrv->tail;
+    if(n == 0) { return; }
+    // Las sumas son exactas, solo el resultado pasa a float32 (en el M0+ los dos son por software y double cuesta mas)
+    const float32_t mean = (float32_t) hrv->sum_rr_us / n;
+    dst->intervals = n;
+    dst->span_s = hrv->sum_rr_us * 1e-6f;
+    dst->mean_rr_ms = mean * 1e-3f;
+    dst->heart_rate_bpm = 60e6f / mean;
+    if(n > 1) {
+        // n * suma de cuadrados - suma^2 se resta en enteros (en float32 se cancelarian casi todos
+        // los bits), entra en int64_t porque la ventana no pasa de HRV_WINDOW_S * HRV_RR_MAX_MS
+        const int64_t spread = (int64_t) n * hrv->sum_rr2_us2 - hrv->sum_rr_us * hrv->sum_rr_us;
+        dst->sdnn_ms = (spread > 0)? sqrtf((float32_t) spread / ((float32_t) n * (n - 1))) * 1e-3f : 0.0f;
+    }
+    if(hrv->diffs) {
+        dst->rmssd_ms = sqrtf((float32_t) hrv->sum_diff2_us2 / hrv->diffs) * 1e-3f;
+        dst->pnn50 = 100.0f * hrv->nn50 / hrv->diffs;
+    }
+    // Potencias en ms^2 (la salida de los pasabandas esta en ms)
+    if(hrv->power_count) {
+        dst->lf_ms2 = hrv->lf.sum / hrv->power_count;
+        dst->hf_ms2 = hrv->hf.sum / hrv->power_count;
+        dst->lf_hf = (dst->hf_ms2 > 0.0f)? dst->lf_ms2 / dst->hf_ms2 : 0.0f;
+    }
+}
+
+/**
+ * @brief Agrega un intervalo valido y saca los que quedan fuera de la ventana
+ * @param hrv puntero al estado
+ * @param rr_us intervalo RR
+*/
+static void hrv_push_interval(hrv_t *hrv, int32_t rr_us) {
+    const int64_t nn50 = (int64_t) HRV_NN50_MS * 1000 * HRV_NN50_MS * 1000;
+    // Con la ventana llena de intervalos cortos saco el mas viejo aunque no haya vencido
+    if(hrv->head - hrv->tail == HRV_INTERVALS_LEN) { hrv_pop_interval(hrv); }
+    // Entra el nuevo con su diferencia sucesiva si el anterior era valido
+    hrv_interval_t *interval = &hrv->intervals[hrv->head & (HRV_INTERVALS_LEN - 1)];
+    interval->rr_us = rr_us;
+    interval->diff_us = hrv->last_rr_us? rr_us - hrv->last_rr_us : HRV_NO_DIFF;
+    hrv->sum_rr_us += rr_us;
+    hrv->sum_rr2_us2 += (int64_t) rr_us * rr_us;
+    if(interval->diff_us != HRV_NO_DIFF) {
+        const int64_t diff2 = (int64_t) interval->diff_us * interval->diff_us;
+        hrv->sum_diff2_us2 += diff2;
+        hrv->diffs++;
+        if(diff2 > nn50) { hrv->nn50++; }
+    }
+    hrv->head++;
+    // Salen los mas viejos hasta que la ventana cubra HRV_WINDOW_S
+    while(hrv->sum_rr_us > (int64_t) HRV_WINDOW_S * 1000000) { hrv_pop_interval(hrv); }
+}
+
+/**
+ * @brief Saca el intervalo mas viejo de la ventana
+ * @param hrv puntero al estado
+*/
+static void hrv_pop_interval(hrv_t *hrv) {
+    const int64_t nn50 = (int64_t) HRV_NN50_MS * 1000 * HRV_NN50_MS * 1000;
+    const hrv_interval_t *old = &hrv->intervals[hrv->tail & (HRV_INTERVALS_LEN - 1)];
+    hrv->sum_rr_us -= old->rr_us;
+    hrv->sum_rr2_us2 -= (int64_t) old->rr_us * old->rr_us;
+    if(old->diff_us != HRV_NO_DIFF) {
+        const int64_t diff2 = (int64_t) old->diff_us * old->diff_us;
+        hrv->sum_diff2_us2 -= diff2;
+        hrv->diffs--;
+        if(diff2 > nn50) { hrv->nn50--; }
+    }
+    hrv->tail++;
+}
+
+/**
+ * @brief Corta el tacograma despues de un RR fuera de rango
+ * @param hrv puntero al estado
+*/
+static void hrv_restart(hrv_t *hrv) {
+    // El hueco no se rellena: el proximo RR valido arranca de nuevo la referencia y los
+    // pasabandas, y las potencias de la ventana se quedan con las muestras que ya tenian
+    hrv->last_rr_us = 0;
+    hrv->baseline_us = 0;
+    hrv->resample_us = 0;
+    memset(hrv->lf.state, 0, sizeof(hrv->lf.state));
+    memset(hrv->hf.state, 0, sizeof(hrv->hf.state));
+}
+
+/**
+ * @brief Remuestrea el tacograma entre el latido anterior y el nuevo y lo pasa por las bandas
+ * @param hrv puntero al estado
+ * @param rr_us intervalo valido desde el latido anterior
+*/
+static void hrv_resample(hrv_t *hrv, int32_t rr_us) {
+    const int32_t period_us = 1000000 / HRV_RESAMPLE_FS;
+    // Interpolo entre el RR anterior y el nuevo (el primero despues de un corte queda constante)
+    const int32_t start = hrv->last_rr_us? hrv->last_rr_us : rr_us;
+    // El primer RR queda de referencia, asi los pasaaltos no arrancan con un escalon
+    if(hrv->baseline_us == 0) { hrv->baseline_us = rr_us; }
+    while(hrv->resample_us <= rr_us) {
+        const float32_t value = (start - hrv->baseline_us + (float32_t) (rr_us - start) * hrv->resample_us / rr_us) / 1e3f;
+        // Con la ventana llena, el segundo que empieza pisa al mas viejo y salen sus muestras
+        if(hrv->power_index % HRV_RESAMPLE_FS == 0 && hrv->power_count == HRV_POWER_LEN) { hrv->power_count -= HRV_RESAMPLE_FS; }
+        hrv_band_add(&hrv->lf, value, hrv->power_index);
+        hrv_band_add(&hrv->hf, value, hrv->power_index);
+        hrv->power_index = (hrv->power_index + 1) % HRV_POWER_LEN;
+        hrv->power_count++;
+        hrv->resample_us += period_us;
+    }
+    hrv->resample_us -= rr_us;
+}
+
+/**
+ * @brief Diseña un pasabanda del tacograma y lo arranca en cero
+ * @param band puntero a la banda
+ * @param f_hp frecuencia de corte inferior
+ * @param f_lp frecuencia de corte superior
+*/
+static void hrv_band_init(hrv_band_t *band, float32_t f_hp, float32_t f_lp) {
+    // Cuarto orden como dos biquads con los Q de los polos de Butterworth
+    const float32_t q[2] = { 0.54119610f, 1.30656296f };
+    for(uint32_t i = 0; i < 2; i++) {
+        hrv_biquad(&band->coeffs[5 * i], f_hp, HRV_RESAMPLE_FS, q[i], true);
+        hrv_biquad(&band->coeffs[5 * (i + 2)], f_lp, HRV_RESAMPLE_FS, q[i], false);
+    }
+    arm_biquad_cascade_df2T_init_f32(&band->instance, HRV_BAND_STAGES, band->coeffs, band->state);
+}
+
+/**
+ * @brief Filtra una muestra del tacograma y actualiza la suma movil de su cuadrado
+ * @param band puntero a la banda
+ * @param value muestra del tacograma en ms
+ * @param index lugar de la muestra en la ventana
+*/
+static void hrv_band_add(hrv_band_t *band, float32_t value, uint32_t index) {
+    float32_t out;
+    arm_biquad_cascade_df2T_f32(&band->instance, &value, &out, 1);
+    // La primera muestra de cada segundo saca de la suma el segundo que estaba en su lugar
+    const uint32_t second = index / HRV_RESAMPLE_FS;
+    if(index % HRV_RESAMPLE_FS == 0) {
+        band->sum -= band->power[second];
+        band->power[second] = 0.0f;
+    }
+    band->power[second] += out * out;
+    band->sum += out * out;
+    // Al dar la vuelta recalculo la suma entera, asi el error de las restas no crece
+    if(index == HRV_POWER_LEN - 1) {
+        band->sum = 0.0f;
+        for(uint32_t i = 0; i < HRV_WINDOW_S; i++) { band->sum += band->power[i]; }
+    }
+}
+
+/**
+ * @brief Biquad pasaaltos o pasabajos
+ * @param coeffs puntero a los 5 coeficientes
+ * @param fc frecuencia de corte
+ * @param fs frecuencia de muestreo
+ * @param q factor de calidad
+ * @param highpass true para pasaaltos, false para pasabajos
+*/
+static void hrv_biquad(float32_t *coeffs, float32_t fc, float32_t fs, float32_t q, bool highpass) {
+    const float32_t w0 = 2.0f * PI * fc / fs;
+    const float32_t cw = cosf(w0);
+    const float32_t alpha = sinf(w0) / (2.0f * q);
+    const float32_t a0 = 1.0f + alpha;
+    const float32_t b0 = (highpass? 1.0f + cw : 1.0f - cw) / 2.0f;
+    const float32_t b1 = highpass? -(1.0f + cw) : 1.0f - cw;
+    // CMSIS suma los terminos de realimentacion, van con el signo cambiado
+    coeffs[0] = b0 / a0;
+    coeffs[1] = b1 / a0;
+    coeffs[2] = b0 / a0;
+    coeffs[3] = 2.0f * cw / a0;
+    coeffs[4] = -(1.0f - alpha) / a0;
+}
@@ -0,0 +1,96 @@
+#include <string.h>
+
+#include "mains.h"
+
+// Prototipos privados
+static void mains_reference(mains_t *mains, uint32_t len);
+
+/**
+ * @brief Inicializa el cancelador con los coeficientes en cero
+ * @param mains puntero al estado
+ * @param f0 frecuencia de la red (50 o 60 Hz)
+ * @param fs frecuencia de muestreo
+ * @return devuelve false si una onda de f0 no entra en MAINS_TAPS_MAX (el cancelador deja pasar la señal)
+*/
+bool mains_init(mains_t *mains, float32_t f0, float32_t fs) {
+    memset(mains, 0, sizeof(mains_t));
+    // Una onda de f0 en la ventana del LMS
+    const uint32_t taps = (uint32_t) (fs / f0 + 0.5f);
+    if(f0 <= 0.0f || taps > MAINS_TAPS_MAX) { return false; }
+    // Solo las armonicas por debajo de fs / 2 (con eso hay mas de dos coeficientes por armonica)
+    while(mains->harmonics < MAINS_HARMONICS && (mains->harmonics + 1) * f0 < fs / 2.0f) { mains->harmonics++; }
+    mains->taps = taps;
+    mains->phase_step = (uint32_t) (f0 / fs * 4294967296.0);
+    // La energia de la referencia en la ventana del LMS queda en 0.25 (el LMS q31 la satura en 1.0)
+    mains->amplitude = (q31_t) (sqrtf(0.5f / (taps * mains->harmonics)) * 2147483648.0f);
+    // Cada armonica se lleva 1 / (2 * armonicas) de la energia y converge con mu / (2 * armonicas) por muestra
+    const float32_t mu = 2.0f * mains->harmonics * 1000.0f / (fs * MAINS_TIME_MS);
+    arm_lms_norm_init_f32(&mains->lms, taps, mains->coeffs, mains->state, mu, MAINS_BLOCK_LEN);
+    // El LMS q31 actualiza los coeficientes escalados por 2^-MAINS_Q31_SHIFT con el mismo paso, asi que lo divido
+    arm_lms_norm_init_q31(&mains->lms_q31, taps, mains->coeffs_q31, mains->state_q31, (q31_t) (mu / (1 << MAINS_Q31_SHIFT) * 2147483648.0f), MAINS_BLOCK_LEN, MAINS_Q31_SHIFT);
+    return true;
+}
+
+/**
+ * @brief Cancela la interferencia de la red en un bloque float32
+ * @param mains puntero al estado
+ * @param src puntero a muestras
+ * @param dst puntero a destino (puede ser el mismo que src)
+ * @param len cantidad de muestras
+*/
+void mains_cancel(mains_t *mains, float32_t *src, float32_t *dst, uint32_t len) {
+    if(mains->harmonics == 0) {
+        if(dst != src) { memcpy(dst, src, len * sizeof(float32_t)); }
+        return;
+    }
+    while(len) {
+        const uint32_t n = (len < MAINS_BLOCK_LEN)? len : MAINS_BLOCK_LEN;
+        mains_reference(mains, n);
+        arm_q31_to_float(mains->reference_q31, mains->reference, n);
+        // La señal es la deseada del LMS y el error es la señal sin la interferencia
+        arm_lms_norm_f32(&mains->lms, mains->reference, src, mains->estimate, dst, n);
+        src += n;
+        dst += n;
+        len -= n;
+    }
+}
+
+/**
+ * @brief Cancela la interferencia de la red en un bloque q31
+ * @param mains puntero al estado
+ * @param src puntero a muestras
+ * @param dst puntero a destino (puede ser el mismo que src)
+ * @param len cantidad de muestras
+*/
+void mains_cancel_q31(mains_t *mains, q31_t *src, q31_t *dst, uint32_t len) {
+    if(mains->harmonics == 0) {
+        if(dst != src) { memcpy(dst, src, len * sizeof(q31_t)); }
+        return;
+    }
+    while(len) {
+        const uint32_t n = (len < MAINS_BLOCK_LEN)? len : MAINS_BLOCK_LEN;
+        mains_reference(mains, n);
+        arm_lms_norm_q31(&mains->lms_q31, mains->reference_q31, src, mains->estimate_q31, dst, n);
+        src += n;
+        dst += n;
+        len -= n;
+    }
+}
+
+/**
+ * @brief Sintetiza la referencia (suma de armonicas) del proximo bloque
+ * @param mains puntero al estado
+ * @param len cantidad de muestras (hasta MAINS_BLOCK_LEN)
+*/
+static void mains_reference(mains_t *mains, uint32_t len) {
+    for(uint32_t i = 0; i < len; i++) {
+        q31_t sum = 0;
+        for(uint32_t h = 1; h <= mains->harmonics; h++) {
+            // arm_sin_q31 toma la fase en [0, 1) como una vuelta
+            const q31_t s = arm_sin_q31((q31_t) ((mains->phase * h) >> 1));
+            sum += (q31_t) (((q63_t) s * mains->amplitude) >> 31);
+        }
+        mains->reference_q31[i] = sum;
+        mains->phase += mains->phase_step;
+    }
+}
@@ -0,0 +1,63 @@
+#include "profile.h"
+
+// Variables privadas
+
+// Contadores de cada etapa
+static profile_counter_t counters[PROFILE_STAGES];
+// Tiempo disponible de cada etapa
+static uint32_t budgets[PROFILE_STAGES];
+// Periodo de reporte actual
+static volatile uint32_t profile_epoch = 1;
+
+/**
+ * @brief Fija el tiempo disponible por ejecucion de una etapa
+ * @param stage etapa
+ * @param budget_us tiempo en us
+*/
+void profile_set_budget(profile_stage_t stage, uint32_t budget_us) {
+    budgets[stage] = budget_us;
+}
+
+#if PROFILE_ENABLED
+/**
+ * @brief Cierra la medicion de una etapa
+ * @param stage etapa medida
+ * @param start valor de profile_start
+*/
+void profile_stop(profile_stage_t stage, uint64_t start) {
+    uint32_t elapsed = (uint32_t) (time_us_64() - start);
+    profile_counter_t *c = &counters[stage];
+    // Empiezo de cero si el reporte ya se llevo este periodo
+    uint32_t epoch = __atomic_load_n(&profile_epoch, __ATOMIC_ACQUIRE);
+    if(c->epoch != epoch) {
+        c->count = 0;
+        c->total_us = 0;
+        c->min_us = UINT32_MAX;
+        c->max_us = 0;
+        c->epoch = epoch;
+    }
+    c->count++;
+    c->total_us += elapsed;
+    if(elapsed < c->min_us) { c->min_us = elapsed; }
+    if(elapsed > c->max_us) { c->max_us = elapsed; }
+}
+#endif
+
+/**
+ * @brief Resume todas las etapas y arranca un periodo nuevo
+ * @param dst puntero a PROFILE_STAGES resumenes
+*/
+void profile_snapshot(profile_report_t *dst) {
+    uint32_t epoch = profile_epoch;
+    for(uint32_t i = 0; i < PROFILE_STAGES; i++) {
+        const profile_counter_t *c = &counters[i];
+        // Las etapas que no midieron en este periodo quedan en cero
+        uint32_t count = (c->epoch == epoch)? c->count : 0;
+        dst[i].count = count;
+        dst[i].min_us = count? c->min_us : 0;
+        dst[i].mean_us = count? c->total_us / count : 0;
+        dst[i].max_us = count? c->max_us : 0;
+        dst[i].budget_us = budgets[i];
+    }
+    __atomic_store_n(&profile_epoch, epoch + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,123 @@
+#include <string.h>
+#include "pico/stdlib.h"
+
+#include "protocol.h"
+
+// Valor inicial del CRC
+#define CRC16_INIT  0xFFFF
+
+// Tabla de a 4 bits del polinomio 0x1021
+static const uint16_t crc16_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+// Prototipos privados
+static void protocol_write(const uint8_t *data, uint32_t len);
+static uint32_t protocol_dtype_size(uint8_t dtype);
+
+/**
+ * @brief Manda una trama binaria por USB
+ * @param stream identificador de flujo
+ * @param dtype tipo de dato de cada elemento
+ * @param seq numero de secuencia
+ * @param data puntero a elementos (el RP2040 ya es little-endian)
+ * @param count cantidad de elementos
+*/
+void protocol_send(uint8_t stream, uint8_t dtype, uint32_t seq, const void *data, uint16_t count) {
+    // Armo el encabezado
+    uint8_t header[PROTOCOL_HEADER_LEN] = {
+        PROTOCOL_SYNC0,
+        PROTOCOL_SYNC1,
+        stream,
+        dtype,
+        (uint8_t) seq, (uint8_t) (seq >> 8), (uint8_t) (seq >> 16), (uint8_t) (seq >> 24),
+        (uint8_t) count, (uint8_t) (count >> 8)
+    };
+    uint32_t len = count * protocol_dtype_size(dtype);
+    // El CRC cubre todo menos el sincronismo
+    uint16_t crc = protocol_crc16(CRC16_INIT, &header[2], PROTOCOL_HEADER_LEN - 2);
+    crc = protocol_crc16(crc, (const uint8_t*) data, len);
+    uint8_t trailer[PROTOCOL_CRC_LEN] = { (uint8_t) crc, (uint8_t) (crc >> 8) };
+    // Mando la trama
+    protocol_write(header, sizeof(header));
+    protocol_write((const uint8_t*) data, len);
+    protocol_write(trailer, sizeof(trailer));
+}
+
+/**
+ * @brief Arma comandos del host a partir de los bytes que llegan por USB
+ * @param rx puntero al estado del receptor
+ * @param byte byte recibido
+ * @return devuelve true si se completo una trama valida (queda en rx)
+*/
+bool protocol_receive(protocol_rx_t *rx, uint8_t byte) {
+    // Busco el sincronismo
+    if(rx->len == 0 && byte != PROTOCOL_SYNC0) { return false; }
+    if(rx->len == 1 && byte != PROTOCOL_SYNC1) {
+        rx->len = (byte == PROTOCOL_SYNC0)? 1 : 0;
+        return false;
+    }
+    rx->buffer[rx->len++] = byte;
+    if(rx->len < PROTOCOL_HEADER_LEN) { return false; }
+    // Con el encabezado completo ya se cuanto falta
+    uint32_t count = rx->buffer[8] | (rx->buffer[9] << 8);
+    uint32_t size = count * protocol_dtype_size(rx->buffer[3]);
+    if(size > PROTOCOL_RX_PAYLOAD_LEN) {
+        rx->len = 0;
+        return false;
+    }
+    if(rx->len < PROTOCOL_HEADER_LEN + size + PROTOCOL_CRC_LEN) { return false; }
+    // Trama completa, el CRC cubre todo menos el sincronismo
+    rx->len = 0;
+    uint16_t crc = protocol_crc16(CRC16_INIT, &rx->buffer[2], PROTOCOL_HEADER_LEN - 2 + size);
+    const uint8_t *trailer = &rx->buffer[PROTOCOL_HEADER_LEN + size];
+    if(crc != (trailer[0] | (trailer[1] << 8))) { return false; }
+    rx->command = rx->buffer[2];
+    rx->payload = &rx->buffer[PROTOCOL_HEADER_LEN];
+    rx->size = size;
+    return true;
+}
+
+/**
+ * @brief Calcula el CRC-16/CCITT-FALSE
+ * @param crc valor anterior (CRC16_INIT al empezar)
+ * @param data puntero a datos
+ * @param len cantidad de bytes
+ * @return CRC actualizado
+*/
+uint16_t protocol_crc16(uint16_t crc, const uint8_t *data, uint32_t len) {
+    // Proceso cada byte de a 4 bits
+    for(uint32_t i = 0; i < len; i++) {
+        crc = (crc << 4) ^ crc16_table[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (crc << 4) ^ crc16_table[(crc >> 12) ^ (data[i] & 0x0F)];
+    }
+    return crc;
+}
+
+/**
+ * @brief Escribe bytes crudos por USB (sin traducir \n a \r\n)
+ * @param data puntero a datos
+ * @param len cantidad de bytes
+*/
+static void protocol_write(const uint8_t *data, uint32_t len) {
+    for(uint32_t i = 0; i < len; i++) { putchar_raw(data[i]); }
+}
+
+/**
+ * @brief Tamaño en bytes de un tipo de dato
+ * @param dtype tipo de dato
+ * @return cantidad de bytes
+*/
+static uint32_t protocol_dtype_size(uint8_t dtype) {
+    switch(dtype) {
+        case PROTOCOL_F32:
+        case PROTOCOL_U32:
+            return 4;
+        case PROTOCOL_I16:
+        case PROTOCOL_U16:
+            return 2;
+        default:
+            return 1;
+    }
+}
@@ -0,0 +1,114 @@
+#include <string.h>
+
+#include "psd.h"
+
+// Prototipos privados
+static void psd_segment(psd_t *psd);
+
+/**
+ * @brief Prepara el estimador y calcula la ventana
+ * @param psd puntero al estado del estimador
+ * @param len muestras por segmento (potencia de 2, PSD_LEN_MIN a PSD_LEN_MAX)
+ * @param window ventana de cada segmento
+ * @param fs frecuencia de muestreo
+ * @return devuelve false si el largo no es valido
+*/
+bool psd_init(psd_t *psd, uint32_t len, psd_window_t window, float32_t fs) {
+    if(len < PSD_LEN_MIN || len > PSD_LEN_MAX) { return false; }
+    if(arm_rfft_fast_init_f32(&psd->rfft_instance, len) != ARM_MATH_SUCCESS) { return false; }
+    psd->len = len;
+    // Calculo la ventana una sola vez
+    switch(window) {
+        case PSD_WINDOW_HANNING: arm_hanning_f32(psd->window, len); break;
+        case PSD_WINDOW_HAMMING: arm_hamming_f32(psd->window, len); break;
+        case PSD_WINDOW_BLACKMAN_HARRIS: arm_blackman_harris_92db_f32(psd->window, len); break;
+        default: arm_fill_f32(1.0f, psd->window, len); break;
+    }
+    // La escala depende de la energia de la ventana
+    float32_t energy;
+    arm_power_f32(psd->window, len, &energy);
+    psd->scale = 2.0f / (fs * energy);
+    // Arranco sin muestras ni segmentos (el primer segmento espera len muestras)
+    psd->fill = 0;
+    psd->segments = 0;
+    memset(psd->buffer, 0, sizeof(psd->buffer));
+    psd->power = NULL;
+    psd->work = NULL;
+    return true;
+}
+
+/**
+ * @brief Arranca un promedio nuevo sobre el acumulador y la memoria de trabajo dados
+ * @param psd puntero al estado del estimador
+ * @param power puntero al acumulador (len / 2 valores, recibe el resultado en psd_get)
+ * @param work puntero a memoria de trabajo (2 * len valores alineados a 8 bytes)
+*/
+void psd_start(psd_t *psd, float32_t *power, float32_t *work) {
+    psd->power = power;
+    psd->work = work;
+    psd->segments = 0;
+    memset(power, 0, (psd->len / 2) * sizeof(float32_t));
+}
+
+/**
+ * @brief Agrega muestras de una señal continua
+ * @param psd puntero al estado del estimador
+ * @param src puntero a muestras
+ * @param count cantidad de muestras
+*/
+void psd_add(psd_t *psd, const float32_t *src, uint32_t count) {
+    const uint32_t hop = psd->len / 2;
+    while(count > 0) {
+        // El buffer se llena hasta len la primera vez y despues de a hop
+        uint32_t n = psd->len - psd->fill;
+        if(n > count) { n = count; }
+        memcpy(&psd->buffer[psd->fill], src, n * sizeof(float32_t));
+        psd->fill += n;
+        src += n;
+        count -= n;
+        if(psd->fill == psd->len) {
+            psd_segment(psd);
+            // La mitad nueva pasa a ser la mitad vieja del proximo segmento
+            memcpy(psd->buffer, &psd->buffer[hop], hop * sizeof(float32_t));
+            psd->fill = hop;
+        }
+    }
+}
+
+/**
+ * @brief Deja en el acumulador el promedio de los segmentos sumados desde psd_start
+ * @param psd puntero al estado del estimador
+ * @return cantidad de segmentos promediados (0 deja el acumulador en cero)
+*/
+uint32_t psd_get(psd_t *psd) {
+    const uint32_t segments = psd->segments;
+    if(segments == 0 || !psd->power) { return 0; }
+    // Resultado en V^2 / Hz (len / 2 bins, de 0 a fs / 2 sin incluirla)
+    arm_scale_f32(psd->power, psd->scale / segments, psd->power, psd->len / 2);
+    // El bin 0 no tiene su imagen en frecuencias negativas
+    psd->power[0] /= 2.0f;
+    // Los segmentos que lleguen hasta el proximo psd_start no se suman
+    psd->power = NULL;
+    psd->segments = 0;
+    return segments;
+}
+
+/**
+ * @brief Suma la potencia del segmento completo
+ * @param psd puntero al estado del estimador
+*/
+static void psd_segment(psd_t *psd) {
+    if(!psd->power) { return; }
+    const uint32_t len = psd->len;
+    float32_t *segment = psd->work;
+    float32_t *spectrum = psd->work + len;
+    // La RFFT destruye la entrada, que ya es una copia con la ventana
+    arm_mult_f32(psd->buffer, psd->window, segment, len);
+    arm_rfft_fast_f32(&psd->rfft_instance, segment, spectrum, 0);
+    // Nyquist viene empaquetado en el valor 1 y no se entrega, dejo solo la continua
+    spectrum[1] = 0.0f;
+    // |X[k]|^2 de cada bin (el segmento ya no hace falta y queda de temporal)
+    arm_cmplx_mag_squared_f32(spectrum, segment, len / 2);
+    arm_add_f32(psd->power, segment, psd->power, len / 2);
+    psd->segments++;
+}
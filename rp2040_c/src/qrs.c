@@ -0,0 +1,262 @@
+#include <string.h>
+
+#include "qrs.h"
+
+// Prototipos privados
+static bool qrs_sample(qrs_t *qrs, q31_t input, q31_t x, qrs_beat_t *beat);
+static bool qrs_peak(qrs_t *qrs, const qrs_peak_t *p, qrs_beat_t *beat);
+static void qrs_locate(const qrs_t *qrs, uint32_t pos, qrs_peak_t *peak);
+static void qrs_accept(qrs_t *qrs, const qrs_peak_t *peak, qrs_beat_t *beat);
+static void qrs_update_threshold(qrs_t *qrs);
+static void qrs_butterworth(q31_t *coeffs, float32_t fc, float32_t fs, bool highpass);
+
+/**
+ * @brief Inicializa el detector (arranca aprendiendo los niveles)
+ * @param qrs puntero al estado del detector
+ * @param fs frecuencia de muestreo (por encima de QRS_FS_MAX se diezma)
+ * @param full_scale volts que representa 1.0 en q31
+*/
+void qrs_init(qrs_t *qrs, float32_t fs, float32_t full_scale) {
+    memset(qrs, 0, sizeof(qrs_t));
+    // El detector corre a fs / decim, que no pasa de QRS_FS_MAX
+    qrs->decim = (uint32_t) ceilf(fs / QRS_FS_MAX);
+    if(qrs->decim == 0) { qrs->decim = 1; }
+    fs /= qrs->decim;
+    // Pasabanda de 5 a 15 Hz
+    qrs_butterworth(&qrs->bp_coeffs[0], 5.0f, fs, true);
+    qrs_butterworth(&qrs->bp_coeffs[5], 15.0f, fs, false);
+    arm_biquad_cas_df1_32x64_init_q31(&qrs->bp_instance, QRS_BP_STAGES, qrs->bp_coeffs, qrs->bp_state, QRS_BP_SHIFT);
+    // Tiempos del algoritmo en muestras (la derivada usa el paso de 200 Hz del original)
+    qrs->stride = (uint32_t) (fs / 200.0f + 0.5f);
+    if(qrs->stride == 0) { qrs->stride = 1; }
+    qrs->window = (uint32_t) (fs * QRS_WINDOW_MS / 1000.0f);
+    qrs->refractory = (uint32_t) (fs * QRS_REFRACTORY_MS / 1000.0f);
+    qrs->twave = (uint32_t) (fs * QRS_TWAVE_MS / 1000.0f);
+    qrs->learn = (uint32_t) (fs * QRS_LEARN_MS / 1000.0f);
+    qrs->full_scale = full_scale;
+}
+
+/**
+ * @brief Procesa un tramo de la señal y devuelve los latidos detectados
+ * @param qrs puntero al estado del detector
+ * @param src puntero a muestras en q31
+ * @param len cantidad de muestras
+ * @param first_sample numero de la primera muestra (ubica los latidos en la señal)
+ * @param beats puntero a destino de los latidos
+ * @param max_beats lugar en beats (los que no entran se descartan)
+ * @return cantidad de latidos en beats
+*/
+uint32_t qrs_process(qrs_t *qrs, const q31_t *src, uint32_t len, uint32_t first_sample, qrs_beat_t *beats, uint32_t max_beats) {
+    // Diferencia entre la numeracion de la señal y la interna (un bloque perdido la corre)
+    const uint32_t offset = first_sample - qrs->count;
+    uint32_t count = 0;
+    while(len > 0) {
+        // Junto hasta QRS_BLOCK_LEN muestras diezmadas (la primera de cada decim)
+        uint32_t n = 0;
+        while(len > 0 && n < QRS_BLOCK_LEN) {
+            if(qrs->count % qrs->decim == 0) { qrs->bp_input[n++] = *src; }
+            qrs->count++;
+            src++;
+            len--;
+        }
+        arm_biquad_cas_df1_32x64_q31(&qrs->bp_instance, qrs->bp_input, qrs->bp_block, n);
+        for(uint32_t i = 0; i < n; i++) {
+            qrs_beat_t beat;
+            if(qrs_sample(qrs, qrs->bp_input[i], qrs->bp_block[i], &beat) && count < max_beats) {
+                beat.sample += offset;
+                beats[count++] = beat;
+            }
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Derivada, cuadrado, integracion y decision de una muestra pasabanda
+ * @param qrs puntero al estado del detector
+ * @param input muestra de entrada
+ * @param x muestra pasabanda
+ * @param beat puntero a destino del latido
+ * @return devuelve true si se detecto un latido
+*/
+static bool qrs_sample(qrs_t *qrs, q31_t input, q31_t x, qrs_beat_t *beat) {
+    const uint32_t mask = QRS_HISTORY_LEN - 1;
+    const uint32_t band_mask = QRS_BAND_LEN - 1;
+    const uint32_t n = qrs->pos;
+    const uint32_t s = qrs->stride;
+    qrs->input_sum += (int64_t) input - qrs->input[(n - qrs->window) & mask];
+    qrs->input[n & mask] = input;
+    qrs->band[n & band_mask] = x;
+    // Derivada de cinco puntos (antes del arranque la historia vale cero)
+    const int64_t d = 2 * (int64_t) x + qrs->band[(n - s) & band_mask] - qrs->band[(n - 3 * s) & band_mask] - 2 * (int64_t) qrs->band[(n - 4 * s) & band_mask];
+    // Divido por 8 y me quedo con 15 bits, asi el cuadrado entra en 30
+    const int32_t slope = (int32_t) (d >> 19);
+    const int32_t squared = slope * slope;
+    // Suma movil: entra el cuadrado nuevo y sale el de hace una ventana
+    qrs->mwi += squared - qrs->squared[(n - qrs->window) & mask];
+    qrs->squared[n & mask] = squared;
+    qrs->pos++;
+
+    // Aprendizaje de los niveles iniciales
+    if(qrs->pos <= qrs->learn) {
+        if(qrs->mwi > qrs->learn_max) { qrs->learn_max = qrs->mwi; }
+        qrs->learn_sum += qrs->mwi;
+        if(qrs->pos == qrs->learn) {
+            qrs->spki = qrs->learn_max / 3;
+            qrs->npki = qrs->learn_sum / qrs->learn / 2;
+            qrs_update_threshold(qrs);
+        }
+    }
+
+    // Un maximo local de la integracion es la muestra anterior a la primera que baja,
+    // me quedo con el mayor hasta que pase un periodo refractario sin otro mas alto
+    // (las ondulaciones de la subida no llegan a clasificarse)
+    if(qrs->mwi < qrs->mwi_prev && qrs->rising && qrs->mwi_prev > qrs->held.peak) {
+        qrs_locate(qrs, n - 1, &qrs->held);
+        qrs->held.peak = qrs->mwi_prev;
+        qrs->held.peak_pos = n - 1;
+    }
+    if(qrs->mwi != qrs->mwi_prev) { qrs->rising = qrs->mwi > qrs->mwi_prev; }
+    qrs->mwi_prev = qrs->mwi;
+    bool found = false;
+    if(qrs->held.peak > 0 && n - qrs->held.peak_pos >= qrs->refractory) {
+        const qrs_peak_t held = qrs->held;
+        qrs->held.peak = 0;
+        found = qrs_peak(qrs, &held, beat);
+    }
+
+    // Busqueda hacia atras: sin latido en 1.66 RR medios tomo el mejor candidato
+    if(!found && qrs->has_beat && qrs->rr_mean && qrs->candidate.peak > 0 && n - qrs->last_peak_pos > qrs->rr_mean * 166 / 100) {
+        qrs->spki = (qrs->candidate.peak + 3 * qrs->spki) / 4;
+        qrs_update_threshold(qrs);
+        qrs_peak_t candidate = qrs->candidate;
+        qrs_accept(qrs, &candidate, beat);
+        found = true;
+    }
+    return found;
+}
+
+/**
+ * @brief Clasifica un maximo de la integracion como QRS o ruido
+ * @param qrs puntero al estado del detector
+ * @param p maximo confirmado con su pico R
+ * @param beat puntero a destino del latido
+ * @return devuelve true si es un latido
+*/
+static bool qrs_peak(qrs_t *qrs, const qrs_peak_t *p, qrs_beat_t *beat) {
+    if(qrs->pos <= qrs->learn) { return false; }
+    const int64_t peak = p->peak;
+    // Dentro del periodo refractario no puede haber otro latido
+    if(qrs->has_beat && p->peak_pos - qrs->last_peak_pos < qrs->refractory) { return false; }
+    if(peak > qrs->threshold) {
+        // Cerca del latido anterior y con menos de la mitad de pendiente es una onda T (el cuadrado baja a un cuarto)
+        if(qrs->has_beat && p->peak_pos - qrs->last_peak_pos < qrs->twave && p->slope < qrs->last_slope / 4) {
+            qrs->npki = (peak + 7 * qrs->npki) / 8;
+            qrs_update_threshold(qrs);
+            return false;
+        }
+        qrs->spki = (peak + 7 * qrs->spki) / 8;
+        qrs_update_threshold(qrs);
+        qrs_accept(qrs, p, beat);
+        return true;
+    }
+    // Ruido, pero si pasa I2 queda como candidato para la busqueda hacia atras
+    qrs->npki = (peak + 7 * qrs->npki) / 8;
+    qrs_update_threshold(qrs);
+    if(peak > qrs->threshold / 2 && peak > qrs->candidate.peak) { qrs->candidate = *p; }
+    return false;
+}
+
+/**
+ * @brief Ubica el pico R y la pendiente maxima dentro de la ventana que termina en pos
+ * @param qrs puntero al estado del detector
+ * @param pos ultima muestra de la ventana
+ * @param peak puntero a destino (completa pos, value, offset y slope)
+*/
+static void qrs_locate(const qrs_t *qrs, uint32_t pos, qrs_peak_t *peak) {
+    const uint32_t mask = QRS_HISTORY_LEN - 1;
+    // Mido el pico contra la media de la ventana, asi un resto de linea de base no lo lleva a la onda S
+    const int64_t baseline = qrs->input_sum / (int64_t) qrs->window;
+    int64_t best = -1;
+    peak->pos = pos;
+    peak->value = 0;
+    peak->slope = 0;
+    for(uint32_t k = pos - qrs->window + 1; k != pos + 1; k++) {
+        const q31_t v = qrs->input[k & mask];
+        const int64_t mag = (v > baseline)? v - baseline : baseline - v;
+        if(mag > best) {
+            best = mag;
+            peak->pos = k;
+            peak->value = v;
+        }
+        if(qrs->squared[k & mask] > peak->slope) { peak->slope = qrs->squared[k & mask]; }
+    }
+    // Vertice de la parabola por el pico y sus vecinas (la siguiente ya esta en la historia)
+    const int64_t before = qrs->input[(peak->pos - 1) & mask];
+    const int64_t after = qrs->input[(peak->pos + 1) & mask];
+    const int64_t curvature = before - 2 * (int64_t) peak->value + after;
+    peak->offset = (curvature != 0)? 0.5f * (float32_t) (before - after) / (float32_t) curvature : 0.0f;
+    if(peak->offset > 0.5f) { peak->offset = 0.5f; }
+    if(peak->offset < -0.5f) { peak->offset = -0.5f; }
+}
+
+/**
+ * @brief Registra un latido y actualiza el RR medio
+ * @param qrs puntero al estado del detector
+ * @param peak latido aceptado
+ * @param beat puntero a destino del latido
+*/
+static void qrs_accept(qrs_t *qrs, const qrs_peak_t *peak, qrs_beat_t *beat) {
+    // Paso el pico a muestras de la señal, la parte entera de la fraccion por decim va a la muestra
+    // (sin diezmar la fraccion no llega a 1 y queda igual)
+    const float32_t exact = peak->offset * qrs->decim;
+    int32_t whole = (int32_t) exact;
+    if(exact - whole > 0.5f) { whole++; }
+    if(exact - whole < -0.5f) { whole--; }
+    beat->sample = peak->pos * qrs->decim + whole;
+    beat->amplitude = peak->value * (qrs->full_scale / 2147483648.0f);
+    beat->rr = qrs->has_beat? beat->sample - qrs->last_sample : 0;
+    beat->offset = exact - whole;
+    if(qrs->has_beat) {
+        // El RR medio de la busqueda hacia atras va en muestras diezmadas
+        qrs->rr[qrs->rr_count % QRS_RR_AVERAGE] = peak->pos - qrs->last_pos;
+        qrs->rr_count++;
+        const uint32_t n = (qrs->rr_count < QRS_RR_AVERAGE)? qrs->rr_count : QRS_RR_AVERAGE;
+        uint32_t sum = 0;
+        for(uint32_t i = 0; i < n; i++) { sum += qrs->rr[i]; }
+        qrs->rr_mean = sum / n;
+    }
+    qrs->has_beat = true;
+    qrs->last_sample = beat->sample;
+    qrs->last_pos = peak->pos;
+    qrs->last_peak_pos = peak->peak_pos;
+    qrs->last_slope = peak->slope;
+    qrs->candidate.peak = 0;
+}
+
+/**
+ * @brief Recalcula el umbral principal a partir de los niveles de señal y ruido
+ * @param qrs puntero al estado del detector
+*/
+static void qrs_update_threshold(qrs_t *qrs) {
+    qrs->threshold = qrs->npki + (qrs->spki - qrs->npki) / 4;
+}
+
+/**
+ * @brief Biquad de Butterworth de segundo orden en q31 (coeficientes escalados por QRS_BP_SHIFT)
+ * @param coeffs puntero a los 5 coeficientes
+ * @param fc frecuencia de corte
+ * @param fs frecuencia de muestreo
+ * @param highpass true para pasaaltos, false para pasabajos
+*/
+static void qrs_butterworth(q31_t *coeffs, float32_t fc, float32_t fs, bool highpass) {
+    const float32_t w0 = 2.0f * PI * fc / fs;
+    const float32_t cw = cosf(w0);
+    const float32_t alpha = sinf(w0) / (2.0f * 0.70710678f);
+    const float32_t a0 = 1.0f + alpha;
+    const float32_t b1 = highpass? -(1.0f + cw) : 1.0f - cw;
+    const float32_t b0 = (highpass? 1.0f + cw : 1.0f - cw) / 2.0f;
+    // CMSIS suma los terminos de realimentacion, van con el signo cambiado
+    const float32_t values[5] = { b0 / a0, b1 / a0, b0 / a0, 2.0f * cw / a0, -(1.0f - alpha) / a0 };
+    for(uint32_t i = 0; i < 5; i++) { coeffs[i] = (q31_t) (values[i] * (2147483648.0f / (1 << QRS_BP_SHIFT))); }
+}